@@ -0,0 +1,106 @@
+"""Decode the output of "matter_bridge trace dump" (CONFIG_BRIDGE_TRACE).
+
+Capture the shell output into a file, e.g. with the terminal's log function, then:
+
+    python3 bridge_trace_decode.py console.log
+
+Lines not starting with "btrace" are ignored, so the log may contain other output. Timestamps are
+in microseconds relative to the first record.
+"""
+import argparse
+import re
+import struct
+import sys
+
+# Keep in sync with BridgeTrace::Event in src/bridge/bridge_trace.h.
+EVENTS = {
+    1: ("ATTRIBUTE_READ", "endpoint", "cluster", "attribute"),
+    2: ("ATTRIBUTE_WRITE", "endpoint", "cluster", "attribute"),
+    3: ("BRIDGE_READ", "index", "cluster", "attribute"),
+    4: ("BRIDGE_WRITE", "index", "cluster", "attribute"),
+    5: ("DEVICE_READ", "endpoint", "cluster", "attribute"),
+    6: ("DEVICE_READ_BASIC", "endpoint", "cluster", "attribute"),
+    7: ("DEVICE_READ_DESCRIPTOR", "endpoint", "cluster", "attribute"),
+    8: ("DEVICE_READ_MISS", "endpoint", "cluster", "attribute"),
+    9: ("DEVICE_WRITE", "endpoint", "cluster", "attribute"),
+    10: ("NOTIFICATION", "handle", "length", None),
+    11: ("NOTIFICATION_ROUTED", "endpoint", "cluster", "attribute"),
+    12: ("GATT_READ", "handle", None, None),
+    13: ("REPORT", "endpoint", "cluster", "attribute"),
+    14: ("NOTIFICATION_BATCH", "endpoint", "count", None),
+    15: ("GATT_WRITE", "handle", "length", "without_response"),
+    16: ("LIVENESS_EXPIRED", "endpoint", "silent_ms", "timeout_ms"),
+}
+
+CLUSTERS = {
+    0x0006: "OnOff",
+    0x0008: "LevelControl",
+    0x001D: "Descriptor",
+    0x0039: "BridgedDeviceBasicInformation",
+    0x0045: "BooleanState",
+}
+
+RECORD = struct.Struct("<IBBHII")
+HEADER_RE = re.compile(r"btrace v(\d+) hz (\d+) first (\d+) written (\d+)")
+RECORD_RE = re.compile(r"btrace (\d+) ([0-9a-fA-F]{32})\s*$")
+
+
+def format_arg(name, value):
+    if name == "cluster":
+        return f"cluster={CLUSTERS.get(value, f'0x{value:04x}')}"
+    if name in ("attribute", "handle"):
+        return f"{name}=0x{value:x}"
+    return f"{name}={value}"
+
+
+def decode(lines, out):
+    hz = None
+    start = None
+    previous = None
+    expected = None
+
+    for line in lines:
+        match = HEADER_RE.search(line)
+        if match:
+            if int(match.group(1)) != 1:
+                sys.exit(f"Unsupported trace format version {match.group(1)}")
+            hz = int(match.group(2))
+            first, written = int(match.group(3)), int(match.group(4))
+            out.write(f"# {written - first} record(s), {first} overwritten, {hz} Hz\n")
+            start = previous = expected = None
+            continue
+
+        match = RECORD_RE.search(line)
+        if not match:
+            continue
+        if hz is None:
+            sys.exit("Record before the trace header, capture the complete dump")
+
+        sequence = int(match.group(1))
+        cycles, event, _, a, b, c = RECORD.unpack(bytes.fromhex(match.group(2)))
+        if expected is not None and sequence != expected:
+            out.write(f"# {sequence - expected} record(s) overwritten while dumping\n")
+        expected = sequence + 1
+
+        if start is None:
+            start = previous = cycles
+        # The cycle counter is 32 bit, deltas are taken modulo 2^32.
+        timestamp_us = ((cycles - start) & 0xFFFFFFFF) * 1000000 // hz
+        delta_us = ((cycles - previous) & 0xFFFFFFFF) * 1000000 // hz
+        previous = cycles
+
+        name, *arg_names = EVENTS.get(event, (f"EVENT_{event}", "a", "b", "c"))
+        args = " ".join(format_arg(n, v) for n, v in zip(arg_names, (a, b, c)) if n)
+        out.write(f"{timestamp_us:>12} us  +{delta_us:<8} {name:<24} {args}\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", nargs="?", type=argparse.FileType("r"), default=sys.stdin,
+                        help="captured console output, default stdin")
+    args = parser.parse_args()
+    decode(args.log, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
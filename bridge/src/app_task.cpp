@@ -17,6 +17,12 @@
 
 #include "app_config.h"
 #include "bridge/bridge_manager.h"
+#ifdef CONFIG_BRIDGE_SIMULATION
+#include "bridge/bridge_simulation.h"
+#endif
+#ifdef CONFIG_BRIDGE_BROADCAST
+#include "bridge/matter_device_broadcast.h"
+#endif
 #include "bridge/matter_device_ble.h"
 #include "bridge/matter_device_fixed.h"
 #include "bridge/oob_exchange_manager.h"
@@ -25,8 +31,9 @@
 #include "display.h"
 
 #include "reminders/reminders_app.h"
+#include "reminders/persistence/persistence.h"
 
-#if defined(CONFIG_WIFI)
+#if defined(CONFIG_DATE_TIME)
 #include <date_time.h>
 #endif
 
@@ -40,6 +47,7 @@
 #endif
 
 #include <dk_buttons_and_leds.h>
+#include <zephyr/bluetooth/bluetooth.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/settings/settings.h>
@@ -55,9 +63,14 @@ namespace {
 constexpr uint32_t kFactoryResetTriggerTimeout = 6000;
 constexpr size_t kAppEventQueueSize = 10;
 
+constexpr uint32_t kTimeSyncRetryInterval = 10;
+// The reminders are loaded from storage and scheduled against the wall clock.
+constexpr uint8_t kRemindersRequirements = kBridgeTimeSynced | kBridgeStorageMounted;
+
 K_MSGQ_DEFINE(sAppEventQueue, sizeof(AppEvent), kAppEventQueueSize, alignof(AppEvent));
 k_timer sFunctionTimer;
-k_timer sBridgeStartTimer;
+struct k_work sStorageMountWork;
+struct k_work_delayable sTimeSyncRetryWork;
 
 LEDWidget sStatusLED;
 
@@ -166,8 +179,8 @@ CHIP_ERROR AppTask::Init() {
   k_timer_init(&sFunctionTimer, &AppTask::FunctionTimerTimeoutCallback, nullptr);
   k_timer_user_data_set(&sFunctionTimer, this);
 
-  k_timer_init(&sBridgeStartTimer, &AppTask::BridgeStartCallback, nullptr);
-  k_timer_user_data_set(&sBridgeStartTimer, this);
+  k_work_init(&sStorageMountWork, StorageMountWorkHandler);
+  k_work_init_delayable(&sTimeSyncRetryWork, TimeSyncRetryWorkHandler);
 
 #ifdef CONFIG_CHIP_OTA_REQUESTOR
   /* OTA image confirmation must be done before the factory data init. */
@@ -207,6 +220,19 @@ CHIP_ERROR AppTask::Init() {
     return err;
   }
 
+  /*
+   * Bring back the bridged endpoints right away. The devices are started once the readiness
+   * signals they depend on are set: BLE devices as soon as BT is enabled, in parallel with the
+   * network bring-up, and the reminders once the time is synced and the storage is mounted.
+   */
+  InitBridge();
+  if (bt_is_ready()) {
+    SignalBridgeReady(kBridgeBtReady);
+  } else {
+    LOG_ERR("BT is not enabled, BLE devices are not started");
+  }
+  k_work_submit(&sStorageMountWork);
+
   NfcUart::Instance().Init(UartMessageHandler);
 
   display_init();
@@ -250,15 +276,61 @@ void AppTask::ButtonEventHandler(uint32_t buttonState, uint32_t hasChanged) {
   }
 }
 
-void AppTask::BridgeStartCallback(k_timer *timer) {
+void AppTask::SignalBridgeReady(uint8_t signals) {
   chip::DeviceLayer::PlatformMgr().ScheduleWork(
       [](intptr_t context) {
-        initRemindersApp(display_updateTranscription, display_updateCompletions);
-        InitBridge();
+        uint8_t signals = static_cast<uint8_t>(context);
+        uint8_t before = BridgeManager::Instance().GetReadySignals();
+        if ((before & kRemindersRequirements) != kRemindersRequirements &&
+            ((before | signals) & kRemindersRequirements) == kRemindersRequirements) {
+          initRemindersApp(display_updateTranscription, display_updateCompletions);
+        }
+        BridgeManager::Instance().SetReady(signals);
       },
-      reinterpret_cast<intptr_t>(nullptr));  
+      static_cast<intptr_t>(signals));
+}
+
+void AppTask::StorageMountWorkHandler(k_work *work) {
+  int err = fs_init(false);
+  if (err) {
+    // Reminders still work, they are just not persisted.
+    LOG_ERR("Failed to mount storage (err %d)", err);
+  }
+  SignalBridgeReady(kBridgeStorageMounted);
 }
 
+void AppTask::RequestTimeSync() {
+#if defined(CONFIG_DATE_TIME)
+  if (date_time_is_valid()) {
+    SignalBridgeReady(kBridgeTimeSynced);
+    return;
+  }
+  date_time_update_async(DateTimeEventHandler);
+#else
+  SignalBridgeReady(kBridgeTimeSynced);
+#endif
+}
+
+#if defined(CONFIG_DATE_TIME)
+void AppTask::DateTimeEventHandler(const struct date_time_evt *evt) {
+  switch (evt->type) {
+    case DATE_TIME_OBTAINED_MODEM:
+    case DATE_TIME_OBTAINED_NTP:
+    case DATE_TIME_OBTAINED_EXT:
+      SignalBridgeReady(kBridgeTimeSynced);
+      break;
+    case DATE_TIME_NOT_OBTAINED:
+      LOG_WRN("Time sync failed, retry in %u s", kTimeSyncRetryInterval);
+      k_work_reschedule(&sTimeSyncRetryWork, K_SECONDS(kTimeSyncRetryInterval));
+      break;
+    default:
+      break;
+  }
+}
+#endif
+
+void AppTask::TimeSyncRetryWorkHandler(k_work *work) { RequestTimeSync(); }
+
 void AppTask::FunctionTimerTimeoutCallback(k_timer *timer) {
   if (!timer) {
     return;
@@ -343,6 +415,7 @@ void AppTask::ChipEventHandler(const ChipDeviceEvent *event, intptr_t /* arg */)
     case DeviceEventType::kCHIPoBLEAdvertisingChange:
       sHaveBLEConnections = ConnectivityMgr().NumBLEConnections() != 0;
       UpdateStatusLED();
+      BLEConnectivityManager::Instance().SetAdvertising(ConnectivityMgr().IsBLEAdvertising());
       break;
 #if defined(CONFIG_NET_L2_OPENTHREAD)
     case DeviceEventType::kDnssdInitialized:
@@ -364,7 +437,10 @@ void AppTask::ChipEventHandler(const ChipDeviceEvent *event, intptr_t /* arg */)
 #endif /* CONFIG_CHIP_OTA_REQUESTOR */
 #endif
       UpdateStatusLED();
-      k_timer_start(&sBridgeStartTimer, K_SECONDS(10), K_NO_WAIT);
+      if (IsNetworkUp() && !(BridgeManager::Instance().GetReadySignals() & kBridgeNetworkUp)) {
+        SignalBridgeReady(kBridgeNetworkUp);
+        RequestTimeSync();
+      }
       break;
     default:
       break;
@@ -433,21 +509,19 @@ void AppTask::InitBridge() {
   chip::DeviceLayer::PlatformMgr().ScheduleWork(
       [](intptr_t context) {
         struct MatterDeviceBle::MatterDeviceConfiguration conf;
-        conf.filter = deviceFilter;
-        conf.matterBleMapping = matterBleMapping;
-        conf.ep = &bridgedPostureEndpoint;
-        conf.deviceTypes = &postureDeviceTypesSpan;
-        conf.dataVersions = &postureDataVersionsSpan;
-        strncpy(conf.name, "posture", 8);
-
-        // By coincidence the reminders use the same device type and clusters
-        // Try to reuse all the definitions except the name
+        conf.profile = &postureProfile;
+        conf.id = 0;
+
         struct MatterDeviceFixed::MatterDeviceConfiguration conf2;
-        conf2.ep = &bridgedPostureEndpoint;
-        conf2.deviceTypes = &postureDeviceTypesSpan;
-        conf2.dataVersions = &postureDataVersionsSpan;
+        conf2.ep = &reminderEndpoint;
+        conf2.deviceTypes = &reminderDeviceTypesSpan;
+        conf2.dataVersions = &reminderDataVersionsSpan;
         strncpy(conf2.name, "reminder", 9);
 
+#ifdef CONFIG_BRIDGE_SIMULATION
+        BridgeSimulation::Instance().SetProfile(&postureProfile);
+#endif
+
 
         /* Initialize bridge manager */
         CHIP_ERROR err = BridgeManager::Instance().Init(conf, conf2);
@@ -456,6 +530,31 @@ void AppTask::InitBridge() {
         } else {
           LOG_INF("BridgeManager initialization ok");
         }
+
+#ifdef CONFIG_BRIDGE_BROADCAST
+        for (uint16_t i = 0; err == CHIP_NO_ERROR && i < CONFIG_BRIDGE_BROADCAST_DEVICES; i++) {
+          struct MatterDeviceBroadcast::MatterDeviceConfiguration conf3;
+          conf3.profile = &postureProfile;
+          conf3.id = i;
+          conf3.addr = *BT_ADDR_LE_ANY;
+          err = BridgeManager::Instance().AddDeviceEndpoint(
+              chip::Platform::New<MatterDeviceBroadcast>(conf3));
+        }
+#endif
       },
       reinterpret_cast<intptr_t>(nullptr));
-}
\ No newline at end of file
+}
+
+void AppTask::StartBridge() {
+  SignalBridgeReady(kBridgeBtReady | kBridgeNetworkUp | kBridgeTimeSynced | kBridgeStorageMounted);
+}
+
+bool AppTask::IsNetworkUp() {
+#if defined(CONFIG_NET_L2_OPENTHREAD)
+  return ConnectivityMgr().IsThreadAttached();
+#elif defined(CONFIG_CHIP_WIFI)
+  return ConnectivityMgr().IsWiFiStationConnected();
+#else
+  return false;
+#endif
+}
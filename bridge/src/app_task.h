@@ -18,6 +18,8 @@
 #endif
 
 struct k_timer;
+struct k_work;
+struct date_time_evt;
 
 class AppTask {
 public:
@@ -29,6 +31,8 @@ public:
 
 	CHIP_ERROR StartApp();
 	static void InitBridge();
+	/* Start all bridged devices without waiting for the remaining readiness signals. */
+	static void StartBridge();
 private:
 	CHIP_ERROR Init();
 
@@ -45,7 +49,14 @@ private:
 	static void ChipEventHandler(const chip::DeviceLayer::ChipDeviceEvent *event, intptr_t arg);
 	static void ButtonEventHandler(uint32_t buttonState, uint32_t hasChanged);
 	static void FunctionTimerTimeoutCallback(k_timer *timer);
-	static void BridgeStartCallback(k_timer *timer);
+	static void SignalBridgeReady(uint8_t signals);
+	static void StorageMountWorkHandler(k_work *work);
+	static void RequestTimeSync();
+	static void TimeSyncRetryWorkHandler(k_work *work);
+#if defined(CONFIG_DATE_TIME)
+	static void DateTimeEventHandler(const struct date_time_evt *evt);
+#endif
+	static bool IsNetworkUp();
 
 	static void UpdateStatusLED();
 	static void LEDStateUpdateHandler(LEDWidget &ledWidget);
@@ -0,0 +1,248 @@
+#include "attribute_cache.h"
+
+#include <app-common/zap-generated/attribute-type.h>
+#include <app-common/zap-generated/ids/Clusters.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <cstring>
+
+LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
+
+using namespace ::chip::app::Clusters;
+
+// Attribute ids from 0xFFF8 on are global attributes (ClusterRevision, FeatureMap, ...)
+static constexpr chip::AttributeId kFirstGlobalAttributeId = 0xFFF8;
+
+static bool IsStringType(EmberAfAttributeType type) {
+  return type == ZCL_CHAR_STRING_ATTRIBUTE_TYPE || type == ZCL_OCTET_STRING_ATTRIBUTE_TYPE;
+}
+
+static bool IsLongStringType(EmberAfAttributeType type) {
+  return type == ZCL_LONG_CHAR_STRING_ATTRIBUTE_TYPE ||
+         type == ZCL_LONG_OCTET_STRING_ATTRIBUTE_TYPE;
+}
+
+uint8_t AttributeCache::Hash(chip::ClusterId clusterId, chip::AttributeId attributeId) {
+  uint32_t h = (clusterId * 0x9E3779B1u) ^ (attributeId * 0x85EBCA77u);
+  return (h ^ (h >> 16)) & (kIndexSize - 1);
+}
+
+int AttributeCache::Find(chip::ClusterId clusterId, chip::AttributeId attributeId) const {
+  uint8_t slot = Hash(clusterId, attributeId);
+  for (uint8_t probe = 0; probe < kIndexSize; probe++) {
+    uint8_t idx = mIndex[slot];
+    if (idx == 0) {
+      return -1;
+    }
+    const Entry &entry = mEntries[idx - 1];
+    if (entry.clusterId == clusterId && entry.attributeId == attributeId) {
+      return idx - 1;
+    }
+    slot = (slot + 1) & (kIndexSize - 1);
+  }
+  return -1;
+}
+
+bool AttributeCache::Insert(chip::ClusterId clusterId, const EmberAfAttributeMetadata &attribute) {
+  VerifyOrReturnValue(mEntryCount < kMaxEntries, false,
+                      LOG_ERR("AttributeCache: no entry left for 0x%x/0x%x", clusterId,
+                              attribute.attributeId));
+  VerifyOrReturnValue(mDataUsed + attribute.size <= kDataSize, false,
+                      LOG_ERR("AttributeCache: no storage left for 0x%x/0x%x (%d bytes)",
+                              clusterId, attribute.attributeId, attribute.size));
+
+  Entry &entry = mEntries[mEntryCount];
+  entry.clusterId = clusterId;
+  entry.attributeId = attribute.attributeId;
+  entry.type = attribute.attributeType;
+  entry.offset = mDataUsed;
+  entry.capacity = attribute.size;
+  entry.length = 0;
+  entry.version = 0;
+  entry.updatedMs = 0;
+  mDataUsed += attribute.size;
+
+  uint8_t slot = Hash(clusterId, attribute.attributeId);
+  while (mIndex[slot] != 0) {
+    slot = (slot + 1) & (kIndexSize - 1);
+  }
+  mIndex[slot] = ++mEntryCount;
+  return true;
+}
+
+CHIP_ERROR AttributeCache::Build(const EmberAfEndpointType *endpoint) {
+  VerifyOrReturnError(endpoint, CHIP_ERROR_INVALID_ARGUMENT);
+
+  k_spinlock_key_t key = k_spin_lock(&mLock);
+  mEntryCount = 0;
+  mDataUsed = 0;
+  memset(mIndex, 0, sizeof(mIndex));
+
+  CHIP_ERROR err = CHIP_NO_ERROR;
+  for (uint8_t c = 0; c < endpoint->clusterCount; c++) {
+    const EmberAfCluster &cluster = endpoint->cluster[c];
+    // Served by MatterDevice itself, no need to cache.
+    if (cluster.clusterId == Descriptor::Id ||
+        cluster.clusterId == BridgedDeviceBasicInformation::Id) {
+      continue;
+    }
+    for (uint16_t a = 0; a < cluster.attributeCount; a++) {
+      const EmberAfAttributeMetadata &attribute = cluster.attributes[a];
+      if (attribute.attributeId >= kFirstGlobalAttributeId) {
+        continue;
+      }
+      if (!Insert(cluster.clusterId, attribute)) {
+        err = CHIP_ERROR_NO_MEMORY;
+      }
+    }
+  }
+  k_spin_unlock(&mLock, key);
+
+  LOG_INF("AttributeCache: %d entries, %d of %d bytes", mEntryCount, mDataUsed, kDataSize);
+  return err;
+}
+
+bool AttributeCache::Set(chip::ClusterId clusterId, chip::AttributeId attributeId,
+                         const void *data, uint16_t length) {
+  k_spinlock_key_t key = k_spin_lock(&mLock);
+  bool changed = SetLocked(clusterId, attributeId, data, length);
+  k_spin_unlock(&mLock, key);
+
+  return changed;
+}
+
+uint8_t AttributeCache::SetMultiple(const Value *values, uint8_t count, bool *changed) {
+  uint8_t changedCount = 0;
+
+  k_spinlock_key_t key = k_spin_lock(&mLock);
+  for (uint8_t i = 0; i < count; i++) {
+    changed[i] = SetLocked(values[i].clusterId, values[i].attributeId, values[i].data,
+                           values[i].length);
+    changedCount += changed[i];
+  }
+  k_spin_unlock(&mLock, key);
+
+  return changedCount;
+}
+
+bool AttributeCache::SetLocked(chip::ClusterId clusterId, chip::AttributeId attributeId,
+                               const void *data, uint16_t length) {
+  uint8_t value[UINT8_MAX];
+  uint16_t valueLength;
+
+  int idx = Find(clusterId, attributeId);
+  if (idx < 0) {
+    LOG_ERR("AttributeCache: 0x%x/0x%x not cached", clusterId, attributeId);
+    return false;
+  }
+  Entry &entry = mEntries[idx];
+
+  // Convert into the ZCL representation first to be able to compare against the cached value.
+  if (IsStringType(entry.type) || IsLongStringType(entry.type)) {
+    uint8_t prefix = IsLongStringType(entry.type) ? 2 : 1;
+    uint16_t stringLength = MIN(length, MIN(entry.capacity, sizeof(value)) - prefix);
+    if (prefix == 2) {
+      sys_put_le16(stringLength, value);
+    } else {
+      value[0] = stringLength;
+    }
+    memcpy(value + prefix, data, stringLength);
+    valueLength = prefix + stringLength;
+  } else {
+    valueLength = MIN(entry.capacity, sizeof(value));
+    memset(value, 0, valueLength);
+    memcpy(value, data, MIN(length, valueLength));
+  }
+
+  bool changed = entry.length != valueLength || memcmp(mData + entry.offset, value, valueLength);
+  if (changed) {
+    memcpy(mData + entry.offset, value, valueLength);
+    entry.length = valueLength;
+    entry.version++;
+  }
+  entry.updatedMs = k_uptime_get();
+
+  return changed;
+}
+
+CHIP_ERROR AttributeCache::Read(chip::ClusterId clusterId, chip::AttributeId attributeId,
+                                uint8_t *buffer, uint16_t maxReadLength) {
+  CHIP_ERROR err = CHIP_NO_ERROR;
+
+  k_spinlock_key_t key = k_spin_lock(&mLock);
+  int idx = Find(clusterId, attributeId);
+  if (idx < 0 || mEntries[idx].length == 0) {
+    err = CHIP_ERROR_NOT_FOUND;
+  } else if (mEntries[idx].length > maxReadLength) {
+    err = CHIP_ERROR_BUFFER_TOO_SMALL;
+  } else {
+    memcpy(buffer, mData + mEntries[idx].offset, mEntries[idx].length);
+  }
+  k_spin_unlock(&mLock, key);
+
+  return err;
+}
+
+bool AttributeCache::Get(chip::ClusterId clusterId, chip::AttributeId attributeId, Entry &entry) {
+  k_spinlock_key_t key = k_spin_lock(&mLock);
+  int idx = Find(clusterId, attributeId);
+  if (idx >= 0) {
+    entry = mEntries[idx];
+  }
+  k_spin_unlock(&mLock, key);
+  return idx >= 0;
+}
+
+uint16_t AttributeCache::Snapshot(uint8_t *buffer, uint16_t size) {
+  uint16_t used = 0;
+
+  k_spinlock_key_t key = k_spin_lock(&mLock);
+  for (uint8_t i = 0; i < mEntryCount; i++) {
+    const Entry &entry = mEntries[i];
+    if (entry.length == 0) {
+      continue;
+    }
+    if (used + kSnapshotValueHeaderSize + entry.length > size) {
+      break;
+    }
+    sys_put_le32(entry.clusterId, buffer + used);
+    sys_put_le32(entry.attributeId, buffer + used + 4);
+    sys_put_le16(entry.length, buffer + used + 8);
+    memcpy(buffer + used + kSnapshotValueHeaderSize, mData + entry.offset, entry.length);
+    used += kSnapshotValueHeaderSize + entry.length;
+  }
+  k_spin_unlock(&mLock, key);
+
+  return used;
+}
+
+uint8_t AttributeCache::Restore(const uint8_t *buffer, uint16_t length) {
+  uint8_t restored = 0;
+  uint16_t pos = 0;
+
+  k_spinlock_key_t key = k_spin_lock(&mLock);
+  while (pos + kSnapshotValueHeaderSize <= length) {
+    chip::ClusterId clusterId = sys_get_le32(buffer + pos);
+    chip::AttributeId attributeId = sys_get_le32(buffer + pos + 4);
+    uint16_t valueLength = sys_get_le16(buffer + pos + 8);
+    const uint8_t *value = buffer + pos + kSnapshotValueHeaderSize;
+    pos += kSnapshotValueHeaderSize + valueLength;
+    if (pos > length) {
+      break;
+    }
+
+    int idx = Find(clusterId, attributeId);
+    if (idx < 0 || valueLength == 0 || valueLength > mEntries[idx].capacity) {
+      continue;
+    }
+    Entry &entry = mEntries[idx];
+    memcpy(mData + entry.offset, value, valueLength);
+    entry.length = valueLength;
+    entry.updatedMs = 0;
+    restored++;
+  }
+  k_spin_unlock(&mLock, key);
+
+  return restored;
+}
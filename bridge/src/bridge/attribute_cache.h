@@ -0,0 +1,88 @@
+#pragma once
+
+#include <app/util/af-types.h>
+#include <lib/core/CHIPError.h>
+#include <lib/core/DataModelTypes.h>
+#include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
+
+// Flat store for the attribute values of one bridged device.
+// The entries and their value storage are laid out when the device is registered, based on the
+// attributes declared for its dynamic endpoint. Lookups by (cluster, attribute) go through a small
+// open addressing hash index built at the same time.
+class AttributeCache {
+ public:
+  static constexpr uint8_t kMaxEntries = CONFIG_BRIDGE_ATTRIBUTE_CACHE_ENTRIES;
+  static constexpr uint16_t kDataSize = CONFIG_BRIDGE_ATTRIBUTE_CACHE_DATA_SIZE;
+  // Cluster id, attribute id and length in front of every value of a snapshot.
+  static constexpr uint16_t kSnapshotValueHeaderSize =
+      sizeof(chip::ClusterId) + sizeof(chip::AttributeId) + sizeof(uint16_t);
+  static constexpr uint16_t kMaxSnapshotSize = kMaxEntries * kSnapshotValueHeaderSize + kDataSize;
+
+  struct Entry {
+    chip::ClusterId clusterId;
+    chip::AttributeId attributeId;
+    EmberAfAttributeType type;
+    uint16_t offset;
+    uint16_t capacity;
+    // Number of valid bytes, 0 if no value was cached yet.
+    uint16_t length;
+    chip::DataVersion version;
+    int64_t updatedMs;
+  };
+
+  struct Value {
+    chip::ClusterId clusterId;
+    chip::AttributeId attributeId;
+    const void *data;
+    uint16_t length;
+  };
+
+  // Lay out entries for all non-global attributes of the endpoint's device specific clusters.
+  CHIP_ERROR Build(const EmberAfEndpointType *endpoint);
+
+  // Store a value received from the device. Integer values are stored little-endian and are
+  // zero-extended or truncated to the attribute size, strings get the ZCL length prefix.
+  // Returns true if the cached value changed.
+  bool Set(chip::ClusterId clusterId, chip::AttributeId attributeId, const void *data,
+           uint16_t length);
+
+  // Store several values at once, a Matter read never sees only part of them. changed[i] tells
+  // whether values[i] changed. Returns the number of changed values.
+  uint8_t SetMultiple(const Value *values, uint8_t count, bool *changed);
+
+  // Copy the cached value in ZCL format. Returns CHIP_ERROR_NOT_FOUND if nothing is cached.
+  CHIP_ERROR Read(chip::ClusterId clusterId, chip::AttributeId attributeId, uint8_t *buffer,
+                  uint16_t maxReadLength);
+
+  bool Get(chip::ClusterId clusterId, chip::AttributeId attributeId, Entry &entry);
+
+  // Serialize all cached values, in ZCL format, for persistent storage. Returns the number of
+  // bytes written, at most kMaxSnapshotSize.
+  uint16_t Snapshot(uint8_t *buffer, uint16_t size);
+  // Put back the values of a snapshot. Values of attributes that are no longer cached or no longer
+  // fit are skipped. Restored entries keep updatedMs 0 until the device sends a value. Returns the
+  // number of restored values.
+  uint8_t Restore(const uint8_t *buffer, uint16_t length);
+
+ private:
+  static constexpr uint8_t kIndexSize = (kMaxEntries * 2 <= 16)   ? 16
+                                        : (kMaxEntries * 2 <= 32) ? 32
+                                        : (kMaxEntries * 2 <= 64) ? 64
+                                                                  : 128;
+  static_assert(kMaxEntries * 2 <= kIndexSize, "Attribute cache index too small");
+
+  static uint8_t Hash(chip::ClusterId clusterId, chip::AttributeId attributeId);
+  int Find(chip::ClusterId clusterId, chip::AttributeId attributeId) const;
+  bool Insert(chip::ClusterId clusterId, const EmberAfAttributeMetadata &attribute);
+  bool SetLocked(chip::ClusterId clusterId, chip::AttributeId attributeId, const void *data,
+                 uint16_t length);
+
+  Entry mEntries[kMaxEntries];
+  uint8_t mEntryCount = 0;
+  // Entry index + 1, 0 marks an empty slot.
+  uint8_t mIndex[kIndexSize] = {};
+  uint8_t mData[kDataSize];
+  uint16_t mDataUsed = 0;
+  struct k_spinlock mLock;
+};
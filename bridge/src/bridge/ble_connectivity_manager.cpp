@@ -6,6 +6,7 @@
 #include <platform/CHIPDeviceLayer.h>
 #include <zephyr/bluetooth/addr.h>
 
+#include "ble_device.h"
 #include "oob_exchange_manager.h"
 
 extern "C" {
@@ -13,11 +14,29 @@ extern "C" {
 }
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
 
 LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
 
 #define CONNECT_IF_MATCH false
 
+// Auto-connect may stay pending for a long time, so it scans with a low duty cycle.
+static const struct bt_conn_le_create_param kAutoConnectParam = BT_CONN_LE_CREATE_PARAM_INIT(
+    BT_CONN_LE_OPT_NONE, BT_GAP_SCAN_SLOW_INTERVAL_1, BT_GAP_SCAN_SLOW_WINDOW_1);
+
+#ifdef CONFIG_BRIDGE_BROADCAST
+// Broadcasting sensors repeat their advertisement while the values stay the same and change it
+// when they do. The controller's duplicate filter would drop the changed ones as well, duplicates
+// are filtered by sequence number in HandleAdvertisement instead.
+static constexpr uint32_t kScanOptions = BT_LE_SCAN_OPT_NONE;
+#else
+static constexpr uint32_t kScanOptions = BT_LE_SCAN_OPT_FILTER_DUPLICATE;
+#endif
+
+// Protects scan requests and connection slots. Accessed from the BT RX thread, the CHIP thread and
+// the system workqueue.
+K_MUTEX_DEFINE(sConnLock);
+
 static void pairing_complete(struct bt_conn *conn, bool bonded) {
   char addr[BT_ADDR_LE_STR_LEN];
   bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
@@ -30,8 +49,12 @@ static void pairing_failed(struct bt_conn *conn, enum bt_security_err reason) {
   LOG_INF("Pairing failed conn: %s, reason %d\n", addr, reason);
 }
 
+// Called for every bond removed by bt_unpair(), the cached handles of the peer are stale then.
+static void bond_deleted(uint8_t id, const bt_addr_le_t *peer) { BleDevice::DeleteGattCache(peer); }
+
 static struct bt_conn_auth_info_cb conn_auth_info_callbacks = {.pairing_complete = pairing_complete,
-                                                               .pairing_failed = pairing_failed};
+                                                               .pairing_failed = pairing_failed,
+                                                               .bond_deleted = bond_deleted};
 
 static void auth_passkey_display(struct bt_conn *conn, unsigned int passkey) {
   char addr[BT_ADDR_LE_STR_LEN];
@@ -99,12 +122,14 @@ static struct bt_conn_auth_cb conn_auth_callbacks = {
     .pairing_confirm = auth_pairing_confirm,
 };
 
-BT_SCAN_CB_INIT(scan_cb, BLEConnectivityManager::ScanResultCallback, NULL, NULL,
+BT_SCAN_CB_INIT(scan_cb, BLEConnectivityManager::ScanResultCallback,
+                BLEConnectivityManager::ScanNoMatchCallback, NULL,
                 BLEConnectivityManager::Connecting);
 
 BT_CONN_CB_DEFINE(conn_callbacks) = {
     .connected = BLEConnectivityManager::ConnectionHandler,
     .disconnected = BLEConnectivityManager::DisconnectionHandler,
+    .le_param_updated = BLEConnectivityManager::ParamUpdatedHandler,
     .identity_resolved = BLEConnectivityManager::IdentityResolvedHandler,
     .security_changed = BLEConnectivityManager::SecurityChangedHandler};
 
@@ -124,6 +149,14 @@ void BLEConnectivityManager::SecurityChangedHandler(struct bt_conn *conn, bt_sec
   }
 }
 
+void BLEConnectivityManager::ParamUpdatedHandler(struct bt_conn *conn, uint16_t interval,
+                                                 uint16_t latency, uint16_t timeout) {
+  char addr[BT_ADDR_LE_STR_LEN];
+  bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
+  LOG_INF("Connection parameters of %s: interval %u, latency %u, timeout %u", addr, interval,
+          latency, timeout);
+}
+
 void BLEConnectivityManager::IdentityResolvedHandler(struct bt_conn *conn, const bt_addr_le_t *rpa,
                                                      const bt_addr_le_t *identity) {
   char addr_identity[BT_ADDR_LE_STR_LEN];
@@ -140,37 +173,160 @@ void BLEConnectivityManager::DisconnectionHandler(bt_conn *conn, uint8_t reason)
   bt_addr_le_to_str(bt_conn_get_dst(conn), addrStr, sizeof(addrStr));
   LOG_INF("Disconnected: %s (reason %u)", addrStr, reason);
 
-  for (size_t i = 0; i < ARRAY_SIZE(Instance().myConnections); i++) {
-    if (Instance().myConnections[i].conn == conn) {
-      Instance().myConnections[i].cb(Instance().myConnections[i].ctx, false,
-                                     Instance().myConnections[i].conn,
-                                     Instance().myConnections[i].serviceUuid);
-      bt_addr_le_copy(&Instance().myConnections[i].addr, &bt_addr_le_none);
-
-      // We may not unref the connection managed by Matter. It will crash!!!
-      // unref pair to implicit ref in the connect function
-      bt_conn_unref(conn);
+  BLEConnectivityManager &mgr = Instance();
+  struct connectionInfo connection;
+  bool found = false;
+
+  k_mutex_lock(&sConnLock, K_FOREVER);
+  for (size_t i = 0; i < ARRAY_SIZE(mgr.myConnections); i++) {
+    if (mgr.myConnections[i].state == connectionInfo::CONNECTED &&
+        mgr.myConnections[i].conn == conn) {
+      connection = mgr.myConnections[i];
+      mgr.myConnections[i] = connectionInfo();
+      mgr.mBringUpStats.connected--;
+      found = true;
       break;
     }
   }
+  // One connection less to share the radio with.
+  mgr.UpdateScanParameters();
+  k_mutex_unlock(&sConnLock);
+
+  if (found) {
+    connection.cb(connection.ctx, false, conn, connection.serviceUuid);
+
+    // We may not unref the connection managed by Matter. It will crash!!!
+    // unref pair to implicit ref in the connect function
+    bt_conn_unref(conn);
+  }
 }
 
 void BLEConnectivityManager::ConnectionHandler(bt_conn *conn, uint8_t conn_err) {
   char addrStr[BT_ADDR_LE_STR_LEN];
   bt_addr_le_to_str(bt_conn_get_dst(conn), addrStr, sizeof(addrStr));
-  LOG_INF("Connected: %s", addrStr);
+  LOG_INF("Connected: %s (err %u)", addrStr, conn_err);
+
+  BLEConnectivityManager &mgr = Instance();
+  struct connectionInfo connection;
+  bool found = false;
+  bool retried = false;
+
+  k_mutex_lock(&sConnLock, K_FOREVER);
+  for (size_t i = 0; i < ARRAY_SIZE(mgr.myConnections); i++) {
+    if (mgr.myConnections[i].state == connectionInfo::CONNECTING &&
+        mgr.myConnections[i].conn == conn) {
+      mgr.mInitiating = false;
+      RadioStop(mgr.mInitiateStartMs, mgr.mRadioStats.initiateMs);
+      connection = mgr.myConnections[i];
+      if (conn_err) {
+        mgr.mBringUpStats.connectFailures++;
+        retried = mgr.RetryWithFallback(mgr.myConnections[i]);
+        if (!retried) {
+          mgr.myConnections[i] = connectionInfo();
+        }
+      } else {
+        mgr.myConnections[i].state = connectionInfo::CONNECTED;
+        mgr.mBringUpStats.connected++;
+        mgr.mBringUpStats.lastBringUpMs = k_uptime_get() - mgr.mBringUpStartMs;
+        LOG_INF("%d device(s) connected %d ms after the first scan request",
+                mgr.mBringUpStats.connected, mgr.mBringUpStats.lastBringUpMs);
+      }
+      found = true;
+      break;
+    }
+  }
+  k_mutex_unlock(&sConnLock);
+
+  if (!found) {
+    mgr.HandleAutoConnection(conn, conn_err);
+    return;
+  }
 
+  if (conn_err) {
+    // unref pair to implicit ref in the connect function
+    bt_conn_unref(conn);
+    // The context only learns about the failure once no candidate is left.
+    if (!retried) {
+      connection.cb(connection.ctx, false, nullptr, connection.serviceUuid);
+    }
+  } else {
+    struct bt_conn_info info;
+    bt_conn_get_info(conn, &info);
+    LOG_INF("  ... Security level: %d, flag: %d", info.security.level, info.security.flags);
+    connection.cb(connection.ctx, true, conn, connection.serviceUuid);
+  }
+
+  // The controller is free again to initiate the next queued connection.
+  mgr.ProcessConnectQueue();
+}
+
+void BLEConnectivityManager::HandleAutoConnection(bt_conn *conn, uint8_t connErr) {
   struct bt_conn_info info;
-  bt_conn_get_info(conn, &info);
-  LOG_INF("  ... Security level: %d, flag: %d", info.security.level, info.security.flags);
+  if (bt_conn_get_info(conn, &info) || info.role != BT_CONN_ROLE_CENTRAL) {
+    // E.g. a Matter commissioner connecting over CHIPoBLE, scanning makes room for it.
+    k_mutex_lock(&sConnLock, K_FOREVER);
+    UpdateScanParameters();
+    k_mutex_unlock(&sConnLock);
+    return;
+  }
 
-  for (size_t i = 0; i < ARRAY_SIZE(Instance().myConnections); i++) {
-    if (Instance().myConnections[i].conn == conn) {
-      Instance().myConnections[i].cb(Instance().myConnections[i].ctx, true, conn,
-                                     Instance().myConnections[i].serviceUuid);
-      break;
+  struct autoConnectInfo peer;
+  bool found = false;
+
+  k_mutex_lock(&sConnLock, K_FOREVER);
+  if (!mAutoConnecting) {
+    k_mutex_unlock(&sConnLock);
+    return;
+  }
+  mAutoConnecting = false;
+  RadioStop(mAutoConnectStartMs, mRadioStats.autoConnectMs);
+
+  for (size_t i = 0; !connErr && !found && i < ARRAY_SIZE(acceptList); i++) {
+    if (acceptList[i].active && bt_addr_le_eq(&acceptList[i].addr, bt_conn_get_dst(conn))) {
+      for (size_t c = 0; c < ARRAY_SIZE(myConnections); c++) {
+        if (myConnections[c].state == connectionInfo::FREE) {
+          peer = acceptList[i];
+          myConnections[c].state = connectionInfo::CONNECTED;
+          // Auto-connect does not hand out a reference, take the one released on disconnect.
+          myConnections[c].conn = bt_conn_ref(conn);
+          bt_addr_le_copy(&myConnections[c].addr, &peer.addr);
+          myConnections[c].connParam = *BT_LE_CONN_PARAM_DEFAULT;
+          myConnections[c].serviceUuid = peer.serviceUuid;
+          myConnections[c].ctx = peer.ctx;
+          myConnections[c].cb = peer.cb;
+          mBringUpStats.connected++;
+          found = true;
+          break;
+        }
+      }
+    }
+  }
+
+  if (found) {
+    // The context got its peer, other peers it waited for are released.
+    for (size_t i = 0; i < ARRAY_SIZE(acceptList); i++) {
+      if (acceptList[i].active && acceptList[i].ctx == peer.ctx) {
+        acceptList[i].active = false;
+        mAcceptListDirty = true;
+      }
     }
+  } else if (connErr) {
+    mBringUpStats.connectFailures++;
   }
+  k_mutex_unlock(&sConnLock);
+
+  char addrStr[BT_ADDR_LE_STR_LEN];
+  bt_addr_le_to_str(bt_conn_get_dst(conn), addrStr, sizeof(addrStr));
+  if (found) {
+    LOG_INF("Auto-connected %s", addrStr);
+    peer.cb(peer.ctx, true, conn, peer.serviceUuid);
+  } else if (!connErr) {
+    LOG_WRN("Auto-connected %s is not awaited anymore", addrStr);
+    bt_conn_disconnect(conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+  }
+
+  // Resume auto-connect for the remaining peers.
+  ProcessConnectQueue();
 }
 
 // This is only called when connect_if_match == true
@@ -181,6 +337,129 @@ void BLEConnectivityManager::Connecting(struct bt_scan_device_info *device_info,
   LOG_INF("Connecting: %s", addr);
 }
 
+bool BLEConnectivityManager::MatchesScanRequest(const struct scanInfo &request,
+                                                const bt_scan_filter_match *filterMatch,
+                                                const bt_addr_le_t *addr) {
+  if (request.filter.type == DeviceFilter::FILTER_TYPE_UUID && filterMatch->uuid.match) {
+    for (size_t u = 0; u < filterMatch->uuid.count; u++) {
+      if (bt_uuid_cmp(request.filter.filter.serviceUuid, filterMatch->uuid.uuid[u]) == 0) {
+        return true;
+      }
+    }
+  } else if (request.filter.type == DeviceFilter::FILTER_TYPE_ADDR && filterMatch->addr.match) {
+    return bt_addr_le_eq(&request.filter.filter.deviceAddress, addr);
+  }
+  return false;
+}
+
+BLEConnectivityManager::scanInfo *BLEConnectivityManager::FindScanRequest(
+    bt_scan_filter_match *filterMatch, const bt_addr_le_t *addr) {
+  for (size_t i = 0; i < ARRAY_SIZE(scanRequests); i++) {
+    if (scanRequests[i].active && MatchesScanRequest(scanRequests[i], filterMatch, addr)) {
+      return &scanRequests[i];
+    }
+  }
+  return nullptr;
+}
+
+static bool IsBonded(const bt_addr_le_t *addr) {
+  struct BondMatch {
+    const bt_addr_le_t *addr;
+    bool found;
+  } match = {addr, false};
+  bt_foreach_bond(
+      BT_ID_DEFAULT,
+      [](const struct bt_bond_info *info, void *user_data) {
+        BondMatch *match = reinterpret_cast<BondMatch *>(user_data);
+        match->found |= bt_addr_le_eq(&info->addr, match->addr);
+      },
+      &match);
+  return match.found;
+}
+
+void BLEConnectivityManager::AddCandidate(const bt_scan_device_info *deviceInfo,
+                                          bt_scan_filter_match *filterMatch) {
+  const bt_addr_le_t *addr = deviceInfo->recv_info->addr;
+  if (IsPeerInUse(addr)) {
+    return;
+  }
+
+  bool bonded = false;
+  bool bondChecked = false;
+  bool windowStarted = false;
+  for (size_t i = 0; i < ARRAY_SIZE(scanRequests); i++) {
+    struct scanInfo &request = scanRequests[i];
+    if (!request.active || !MatchesScanRequest(request, filterMatch, addr)) continue;
+
+    if (!bondChecked) {
+      bonded = IsBonded(addr);
+      bondChecked = true;
+    }
+    bool first = request.candidateCount == 0;
+    if (CandidateRanking::AddReport(request.candidates, request.candidateCount,
+                                    ARRAY_SIZE(request.candidates), addr,
+                                    deviceInfo->recv_info->rssi, bonded) &&
+        first) {
+      // The first match opens the window, the best candidate is connected once it closed.
+      request.selectDeadline = k_uptime_get() + kCandidateWindowMs;
+      windowStarted = true;
+    }
+  }
+  if (windowStarted) {
+    UpdateScanTimer();
+  }
+}
+
+bool BLEConnectivityManager::SelectCandidate(struct scanInfo &request) {
+  CandidateRanking::Rank(request.candidates, request.candidateCount);
+  const struct bt_uuid *serviceUuid = request.filter.type == DeviceFilter::FILTER_TYPE_UUID
+                                    ? request.filter.filter.serviceUuid
+                                    : nullptr;
+
+  // Another request may have taken a candidate in the meantime.
+  struct connectionInfo *connection = nullptr;
+  uint8_t next = 0;
+  while (!connection && next < request.candidateCount) {
+    const CandidateRanking::Candidate &candidate = request.candidates[next++];
+    if (IsPeerInUse(&candidate.addr)) continue;
+
+    char addrStr[BT_ADDR_LE_STR_LEN];
+    bt_addr_le_to_str(&candidate.addr, addrStr, sizeof(addrStr));
+    LOG_INF("Selected %s out of %u candidate(s), rssi %d, %s", addrStr, request.candidateCount,
+            CandidateRanking::MeanRssi(candidate), candidate.bonded ? "bonded" : "not bonded");
+    connection = QueueConnection(&candidate.addr, nullptr, request.ctx, request.cb, serviceUuid);
+  }
+
+  if (connection) {
+    for (; next < request.candidateCount; next++) {
+      bt_addr_le_copy(&connection->fallbacks[connection->fallbackCount++],
+                      &request.candidates[next].addr);
+    }
+  }
+  request.candidateCount = 0;
+  return connection != nullptr;
+}
+
+bool BLEConnectivityManager::RetryWithFallback(struct connectionInfo &connection) {
+  while (connection.fallbackCount) {
+    bt_addr_le_t addr = connection.fallbacks[0];
+    connection.fallbackCount--;
+    memmove(&connection.fallbacks[0], &connection.fallbacks[1],
+            connection.fallbackCount * sizeof(connection.fallbacks[0]));
+    if (IsPeerInUse(&addr)) continue;
+
+    char addrStr[BT_ADDR_LE_STR_LEN];
+    bt_addr_le_to_str(&addr, addrStr, sizeof(addrStr));
+    LOG_INF("  ... trying the next candidate %s", addrStr);
+    connection.state = connectionInfo::QUEUED;
+    connection.conn = nullptr;
+    bt_addr_le_copy(&connection.addr, &addr);
+    mBringUpStats.candidateFallbacks++;
+    return true;
+  }
+  return false;
+}
+
 void BLEConnectivityManager::ScanResultCallback(bt_scan_device_info *device_info,
                                                 bt_scan_filter_match *filter_match,
                                                 bool connectable) {
@@ -189,43 +468,172 @@ void BLEConnectivityManager::ScanResultCallback(bt_scan_device_info *device_info
     return;
   }
 
-  char addr[BT_ADDR_LE_STR_LEN];
-  bt_addr_le_to_str(device_info->recv_info->addr, addr, sizeof(addr));
-  LOG_INF("Scan result: %s", addr);
-
-  if (filter_match->uuid.match) {
-    if (bt_uuid_cmp(Instance().scanState.serviceUuid, filter_match->uuid.uuid[0]) == 0) {
-      if (!CONNECT_IF_MATCH) {
-        for (size_t i = 0; i < ARRAY_SIZE(Instance().myConnections); i++) {
-          if (bt_addr_le_eq(&Instance().myConnections[i].addr, &bt_addr_le_none)) {
-            bt_addr_le_copy(&Instance().myConnections[i].addr, device_info->recv_info->addr);
-            Instance().myConnections[i].serviceUuid = Instance().scanState.serviceUuid;
-            Instance().myConnections[i].ctx = Instance().scanState.ctx;
-            Instance().myConnections[i].cb = Instance().scanState.cb;
-            break;
+  BLEConnectivityManager &mgr = Instance();
+#ifdef CONFIG_BRIDGE_BROADCAST
+  mgr.HandleAdvertisement(device_info);
+#endif
+
+  // Every advertising report passes here, skip formatting the address unless it is logged.
+  if (CONFIG_CHIP_APP_LOG_LEVEL >= LOG_LEVEL_DBG) {
+    char addr[BT_ADDR_LE_STR_LEN];
+    bt_addr_le_to_str(device_info->recv_info->addr, addr, sizeof(addr));
+    LOG_DBG("Scan result: %s, rssi %d", addr, device_info->recv_info->rssi);
+  }
+
+  if (CONNECT_IF_MATCH || !connectable) {
+    return;
+  }
+
+  k_mutex_lock(&sConnLock, K_FOREVER);
+  if (kCandidateWindowMs > 0) {
+    mgr.AddCandidate(device_info, filter_match);
+    k_mutex_unlock(&sConnLock);
+    return;
+  }
+
+  struct scanInfo *request = mgr.FindScanRequest(filter_match, device_info->recv_info->addr);
+  if (request) {
+    const struct bt_uuid *serviceUuid = request->filter.type == DeviceFilter::FILTER_TYPE_UUID
+                                      ? request->filter.filter.serviceUuid
+                                      : nullptr;
+    if (mgr.QueueConnection(device_info->recv_info->addr, device_info->conn_param, request->ctx,
+                            request->cb, serviceUuid)) {
+      // The request is served. Other requests keep scanning.
+      request->active = false;
+      mgr.ApplyScanFilters();
+      mgr.UpdateScanTimer();
+    }
+  }
+  k_mutex_unlock(&sConnLock);
+
+  mgr.ProcessConnectQueue();
+}
+
+// Advertisements not matching any scan request, all of them while only listeners scan.
+void BLEConnectivityManager::ScanNoMatchCallback(bt_scan_device_info *device_info,
+                                                 bool connectable) {
+#ifdef CONFIG_BRIDGE_BROADCAST
+  Instance().HandleAdvertisement(device_info);
+#endif
+}
+
+BLEConnectivityManager::connectionInfo *BLEConnectivityManager::QueueConnection(
+    const bt_addr_le_t *addr, const bt_le_conn_param *connParams, void *ctx, ScanCallback cb,
+    const struct bt_uuid *serviceUuid) {
+  for (size_t i = 0; i < ARRAY_SIZE(myConnections); i++) {
+    if (bt_addr_le_eq(&myConnections[i].addr, addr)) {
+      LOG_INF("  ... already queued or connected");
+      return nullptr;
+    }
+  }
+
+  for (size_t i = 0; i < ARRAY_SIZE(myConnections); i++) {
+    if (myConnections[i].state == connectionInfo::FREE) {
+      myConnections[i].state = connectionInfo::QUEUED;
+      myConnections[i].conn = nullptr;
+      bt_addr_le_copy(&myConnections[i].addr, addr);
+      myConnections[i].connParam = connParams ? *connParams : *BT_LE_CONN_PARAM_DEFAULT;
+      myConnections[i].serviceUuid = serviceUuid;
+      myConnections[i].ctx = ctx;
+      myConnections[i].cb = cb;
+      myConnections[i].fallbackCount = 0;
+      return &myConnections[i];
+    }
+  }
+
+  LOG_WRN("No free connection slot");
+  return nullptr;
+}
+
+void BLEConnectivityManager::ProcessConnectQueue() {
+  struct connectionInfo failed;
+  bool connectFailed = false;
+  bool retry = false;
+
+  k_mutex_lock(&sConnLock, K_FOREVER);
+  if (!mInitiating) {
+    for (size_t i = 0; i < ARRAY_SIZE(myConnections); i++) {
+      if (myConnections[i].state == connectionInfo::QUEUED) {
+        // The controller initiates one connection at a time, explicit ones take precedence over
+        // auto-connect. Auto-connect resumes once connected.
+        StopAutoConnect();
+#if !defined(CONFIG_BT_SCAN_AND_INITIATE_IN_PARALLEL)
+        // The controller cannot initiate while scanning. Scanning resumes once connected.
+        if (mScanning) {
+          bt_scan_stop();
+          mScanning = false;
+          mScanScheduler.Stop(k_uptime_get());
+        }
+#endif
+        if (Connect(myConnections[i]) == 0) {
+          myConnections[i].state = connectionInfo::CONNECTING;
+          mInitiating = true;
+          RadioStart(mInitiateStartMs);
+        } else {
+          mBringUpStats.connectFailures++;
+          retry = RetryWithFallback(myConnections[i]);
+          if (!retry) {
+            failed = myConnections[i];
+            myConnections[i] = connectionInfo();
+            connectFailed = true;
           }
         }
-        Instance().StopScan();
-        Instance().Connect(device_info->recv_info->addr, device_info->conn_param);
+        break;
       }
     }
   }
+  if (!mInitiating) {
+    ResumeScan();
+  }
+  k_mutex_unlock(&sConnLock);
+
+  if (connectFailed) {
+    failed.cb(failed.ctx, false, nullptr, failed.serviceUuid);
+  }
+  if (connectFailed || retry) {
+    ProcessConnectQueue();
+  }
 }
 
-CHIP_ERROR BLEConnectivityManager::PrepareFilterForUuid(bt_uuid *serviceUuid) {
+CHIP_ERROR BLEConnectivityManager::ApplyScanFilters() {
   int err;
+  uint8_t mode = 0;
 
   bt_scan_filter_disable();
   bt_scan_filter_remove_all();
 
-  err = bt_scan_filter_add(BT_SCAN_FILTER_TYPE_UUID, serviceUuid);
+  for (size_t i = 0; i < ARRAY_SIZE(scanRequests); i++) {
+    if (!scanRequests[i].active) continue;
 
-  if (err) {
-    LOG_ERR("Failed to set scanning filter");
-    return chip::System::MapErrorZephyr(err);
+    switch (scanRequests[i].filter.type) {
+      case DeviceFilter::FILTER_TYPE_UUID:
+        err = bt_scan_filter_add(BT_SCAN_FILTER_TYPE_UUID,
+                                 scanRequests[i].filter.filter.serviceUuid);
+        mode |= BT_SCAN_UUID_FILTER;
+        break;
+      case DeviceFilter::FILTER_TYPE_ADDR:
+        err = bt_scan_filter_add(BT_SCAN_FILTER_TYPE_ADDR,
+                                 &scanRequests[i].filter.filter.deviceAddress);
+        mode |= BT_SCAN_ADDR_FILTER;
+        break;
+      default:
+        err = -ENOTSUP;
+        break;
+    }
+
+    // Several requests may share the same service uuid.
+    if (err && err != -EALREADY) {
+      LOG_ERR("Failed to set scanning filter (err %d)", err);
+      return chip::System::MapErrorZephyr(err);
+    }
+  }
+
+  if (mode == 0) {
+    return CHIP_NO_ERROR;
   }
 
-  err = bt_scan_filter_enable(BT_SCAN_UUID_FILTER, false);
+  // Match any of the filters, each request is checked in ScanResultCallback.
+  err = bt_scan_filter_enable(mode, false);
   if (err) {
     LOG_ERR("Filters cannot be turned on");
     return chip::System::MapErrorZephyr(err);
@@ -234,28 +642,215 @@ CHIP_ERROR BLEConnectivityManager::PrepareFilterForUuid(bt_uuid *serviceUuid) {
   return CHIP_NO_ERROR;
 }
 
-CHIP_ERROR BLEConnectivityManager::PrepareFilterForAddr(bt_addr_le_t *addr) {
-  int err;
+void BLEConnectivityManager::ResumeScan() {
+  bool pending = false;
+  for (size_t i = 0; i < ARRAY_SIZE(scanRequests); i++) {
+    pending |= scanRequests[i].active;
+  }
+#ifdef CONFIG_BRIDGE_BROADCAST
+  pending |= IsListening();
+#endif
 
-  bt_scan_filter_disable();
-  bt_scan_filter_remove_all();
+  if (pending && !mScanning) {
+#if !defined(CONFIG_BT_SCAN_AND_INITIATE_IN_PARALLEL)
+    // Scan requests are bounded by their timeout, auto-connect waits until they are served.
+    StopAutoConnect();
+#endif
+    StartScanning();
+  } else if (pending) {
+    // A new request may need scan responses, or a connection was added in the meantime.
+    UpdateScanParameters();
+  } else if (mScanning) {
+    LOG_INF("Stop scanning");
+    int err = bt_scan_stop();
+    if (err) {
+      LOG_ERR("Scanning failed to stop (err %d)", err);
+    }
+    mScanning = false;
+    mScanScheduler.Stop(k_uptime_get());
+  }
+
+  UpdateAutoConnect();
+}
 
-  err = bt_scan_filter_add(BT_SCAN_FILTER_TYPE_ADDR, addr);
+ScanScheduler::Conditions BLEConnectivityManager::GetScanConditions() {
+  ScanScheduler::Conditions conditions = {0, mAdvertising, false};
+  // All connections count, the bridged devices as well as a commissioner on CHIPoBLE.
+  bt_conn_foreach(
+      BT_CONN_TYPE_LE,
+      [](struct bt_conn *conn, void *user_data) {
+        struct bt_conn_info info;
+        if (bt_conn_get_info(conn, &info) == 0 && info.state == BT_CONN_STATE_CONNECTED) {
+          reinterpret_cast<ScanScheduler::Conditions *>(user_data)->connections++;
+        }
+      },
+      &conditions);
+  for (size_t i = 0; i < ARRAY_SIZE(scanRequests); i++) {
+    conditions.needsScanResponse |= scanRequests[i].active &&
+                                    scanRequests[i].filter.type == DeviceFilter::FILTER_TYPE_UUID;
+  }
+  return conditions;
+}
+
+int BLEConnectivityManager::StartScanning() {
+  ScanScheduler::Parameters parameters = ScanScheduler::Select(GetScanConditions());
+  struct bt_le_scan_param param = {
+      .type = parameters.active ? BT_LE_SCAN_TYPE_ACTIVE : BT_LE_SCAN_TYPE_PASSIVE,
+      .options = kScanOptions,
+      .interval = parameters.interval,
+      .window = parameters.window,
+  };
+  LOG_INF("Start %s scanning, window %u, interval %u", parameters.active ? "active" : "passive",
+          parameters.window, parameters.interval);
+  bt_scan_params_set(&param);
 
+  int err =
+      bt_scan_start(parameters.active ? BT_SCAN_TYPE_SCAN_ACTIVE : BT_SCAN_TYPE_SCAN_PASSIVE);
   if (err) {
-    LOG_ERR("Failed to set scanning filter");
-    return chip::System::MapErrorZephyr(err);
+    LOG_ERR("Scan start not successful (err %d)", err);
+  } else {
+    mScanning = true;
+    mScanScheduler.Start(parameters, k_uptime_get());
   }
+  return err;
+}
 
-  err = bt_scan_filter_enable(BT_SCAN_ADDR_FILTER, false);
+void BLEConnectivityManager::UpdateScanParameters() {
+  if (!mScanning ||
+      ScanScheduler::Select(GetScanConditions()) == mScanScheduler.GetParameters()) {
+    return;
+  }
+  // The parameters cannot be changed while scanning.
+  int err = bt_scan_stop();
   if (err) {
-    LOG_ERR("Filters cannot be turned on");
-    return chip::System::MapErrorZephyr(err);
+    LOG_ERR("Scanning failed to stop (err %d)", err);
+    return;
   }
+  mScanning = false;
+  mScanScheduler.Stop(k_uptime_get());
+  StartScanning();
+}
 
-  return CHIP_NO_ERROR;
+void BLEConnectivityManager::SetAdvertising(bool advertising) {
+  k_mutex_lock(&sConnLock, K_FOREVER);
+  mAdvertising = advertising;
+  UpdateScanParameters();
+  k_mutex_unlock(&sConnLock);
+}
+
+void BLEConnectivityManager::UpdateAutoConnect() {
+  bool pending = false;
+  for (size_t i = 0; i < ARRAY_SIZE(acceptList); i++) {
+    pending |= acceptList[i].active;
+  }
+
+  bool radioFree = !mInitiating;
+#if !defined(CONFIG_BT_SCAN_AND_INITIATE_IN_PARALLEL)
+  radioFree = radioFree && !mScanning;
+#endif
+
+  // The accept list cannot be changed while auto-connect is using it.
+  if (mAutoConnecting && (!pending || !radioFree || mAcceptListDirty)) {
+    StopAutoConnect();
+  }
+  if (!pending || !radioFree || mAutoConnecting) {
+    return;
+  }
+
+  if (mAcceptListDirty) {
+    bt_le_filter_accept_list_clear();
+    for (size_t i = 0; i < ARRAY_SIZE(acceptList); i++) {
+      if (acceptList[i].active) {
+        int err = bt_le_filter_accept_list_add(&acceptList[i].addr);
+        if (err) {
+          LOG_ERR("Adding peer to the accept list failed (err %d)", err);
+        }
+      }
+    }
+    mAcceptListDirty = false;
+  }
+
+  int err = bt_conn_le_create_auto(&kAutoConnectParam, BT_LE_CONN_PARAM_DEFAULT);
+  if (err) {
+    LOG_ERR("Starting auto-connect failed (err %d)", err);
+  } else {
+    mAutoConnecting = true;
+    RadioStart(mAutoConnectStartMs);
+  }
+}
+
+void BLEConnectivityManager::StopAutoConnect() {
+  if (!mAutoConnecting) {
+    return;
+  }
+
+  int err = bt_conn_create_auto_stop();
+  if (err) {
+    LOG_ERR("Stopping auto-connect failed (err %d)", err);
+  }
+  mAutoConnecting = false;
+  RadioStop(mAutoConnectStartMs, mRadioStats.autoConnectMs);
+}
+
+void BLEConnectivityManager::UpdateScanTimer() {
+  int64_t nextDeadline = INT64_MAX;
+  for (size_t i = 0; i < ARRAY_SIZE(scanRequests); i++) {
+    if (scanRequests[i].active) {
+      nextDeadline = MIN(nextDeadline, scanRequests[i].deadline);
+      if (scanRequests[i].candidateCount) {
+        nextDeadline = MIN(nextDeadline, scanRequests[i].selectDeadline);
+      }
+    }
+  }
+
+  if (nextDeadline == INT64_MAX) {
+    k_timer_stop(&mScanTimer);
+  } else {
+    k_timer_start(&mScanTimer, K_MSEC(MAX(0, nextDeadline - k_uptime_get())), K_NO_WAIT);
+  }
 }
 
+void BLEConnectivityManager::ExpireScanRequests() {
+  struct scanInfo expired[kMaxScanRequests];
+  size_t expiredCount = 0;
+  bool served = false;
+
+  k_mutex_lock(&sConnLock, K_FOREVER);
+  int64_t now = k_uptime_get();
+  for (size_t i = 0; i < ARRAY_SIZE(scanRequests); i++) {
+    struct scanInfo &request = scanRequests[i];
+    if (!request.active) continue;
+
+    // A request whose window closed, or that timed out while collecting, takes the best candidate.
+    if (request.candidateCount && (request.selectDeadline <= now || request.deadline <= now) &&
+        SelectCandidate(request)) {
+      request.active = false;
+      served = true;
+    } else if (request.deadline <= now) {
+      request.active = false;
+      expired[expiredCount++] = request;
+    }
+  }
+  if (expiredCount || served) {
+    ApplyScanFilters();
+    if (!mInitiating) {
+      ResumeScan();
+    }
+  }
+  UpdateScanTimer();
+  k_mutex_unlock(&sConnLock);
+
+  if (served) {
+    ProcessConnectQueue();
+  }
+
+  for (size_t i = 0; i < expiredCount; i++) {
+    const struct bt_uuid *serviceUuid = expired[i].filter.type == DeviceFilter::FILTER_TYPE_UUID
+                                      ? expired[i].filter.filter.serviceUuid
+                                      : nullptr;
+    expired[i].cb(expired[i].ctx, false, nullptr, serviceUuid);
+  }
+}
 
 CHIP_ERROR BLEConnectivityManager::Init() {
   LOG_INF("BLEConnectivityManager::Init()");
@@ -263,6 +858,7 @@ CHIP_ERROR BLEConnectivityManager::Init() {
   k_timer_init(&mScanTimer, BLEConnectivityManager::ScanTimeoutCallback, nullptr);
   k_timer_user_data_set(&mScanTimer, this);
 
+  // The scan parameters are set by StartScanning.
   bt_scan_init_param scan_init = {
       .connect_if_match = CONNECT_IF_MATCH,
   };
@@ -277,57 +873,96 @@ CHIP_ERROR BLEConnectivityManager::Init() {
 
 CHIP_ERROR BLEConnectivityManager::Scan(void *ctx, ScanCallback cb, DeviceFilter filter,
                                         uint32_t scanTimeoutMs) {
-  CHIP_ERROR ret = CHIP_NO_ERROR;
   char str[BT_UUID_STR_LEN];
 
-  if (scanState.scanning) {
-    LOG_WRN("Scan is already in progress. Restart scanning");
-    Instance().StopScan();
-  }
-
-  scanState.scanning = true;
-  scanState.ctx = ctx;
-  scanState.cb = cb;
-
   switch (filter.type) {
     case DeviceFilter::FILTER_TYPE_UUID:
-      ret = PrepareFilterForUuid(filter.filter.serviceUuid);
       bt_uuid_to_str(filter.filter.serviceUuid, str, sizeof(str));
       LOG_INF("Scan for uuid %s", str);
-      scanState.serviceUuid = filter.filter.serviceUuid;
       break;
     case DeviceFilter::FILTER_TYPE_ADDR:
-      ret = PrepareFilterForAddr(&filter.filter.deviceAddress);
       bt_addr_le_to_str(&filter.filter.deviceAddress, str, sizeof(str));
       LOG_INF("Scan for addr %s", str);
-      scanState.serviceUuid = filter.filter.serviceUuid;
       break;
     default:
-      LOG_ERR("Not implemented. Only FILTER_TYPE_UUID supported");
+      LOG_ERR("Not implemented. Only FILTER_TYPE_UUID and FILTER_TYPE_ADDR supported");
       return CHIP_ERROR_NOT_IMPLEMENTED;
+  }
+
+  k_mutex_lock(&sConnLock, K_FOREVER);
+
+  struct scanInfo *request = nullptr;
+  for (size_t i = 0; i < ARRAY_SIZE(scanRequests); i++) {
+    if (scanRequests[i].active && scanRequests[i].ctx == ctx) {
+      LOG_WRN("Scan is already in progress for this device. Replace request");
+      request = &scanRequests[i];
       break;
+    }
+    if (!request && !scanRequests[i].active) {
+      request = &scanRequests[i];
+    }
+  }
+
+  if (!request) {
+    k_mutex_unlock(&sConnLock);
+    LOG_ERR("No free scan request slot");
+    return CHIP_ERROR_NO_MEMORY;
+  }
+
+  if (mBringUpStats.connected == 0 && !mScanning) {
+    mBringUpStartMs = k_uptime_get();
   }
 
-  VerifyOrReturnValue(ret == CHIP_NO_ERROR, ret,
-                      LOG_ERR("Scan filter preparation not successful."));
+  request->active = true;
+  request->filter = filter;
+  request->deadline = k_uptime_get() + scanTimeoutMs;
+  request->candidateCount = 0;
+  request->ctx = ctx;
+  request->cb = cb;
+
+  CHIP_ERROR ret = ApplyScanFilters();
+  if (ret == CHIP_NO_ERROR) {
+    UpdateScanTimer();
+    if (!mInitiating) {
+      ResumeScan();
+    }
+  } else {
+    LOG_ERR("Scan filter preparation not successful.");
+    request->active = false;
+  }
 
-  ret = chip::System::MapErrorZephyr(bt_scan_start(BT_SCAN_TYPE_SCAN_ACTIVE));
-  VerifyOrReturnValue(ret == CHIP_NO_ERROR, ret, LOG_ERR("Scan start not successful."));
+  k_mutex_unlock(&sConnLock);
+  return ret;
+}
 
-  k_timer_start(&mScanTimer, K_MSEC(scanTimeoutMs), K_NO_WAIT);
+CHIP_ERROR BLEConnectivityManager::StopScan(void *ctx) {
+  k_mutex_lock(&sConnLock, K_FOREVER);
+  for (size_t i = 0; i < ARRAY_SIZE(scanRequests); i++) {
+    if (scanRequests[i].ctx == ctx) {
+      scanRequests[i].active = false;
+    }
+  }
+  CHIP_ERROR ret = ApplyScanFilters();
+  UpdateScanTimer();
+  ResumeScan();
+  k_mutex_unlock(&sConnLock);
   return ret;
 }
 
 CHIP_ERROR BLEConnectivityManager::StopScan() {
   LOG_INF("Stop scanning");
 
-  StopTimer();
-  scanState.scanning = false;
-  scanState.serviceUuid = nullptr;
-  scanState.ctx = nullptr;
-  scanState.cb = nullptr;
-
+  k_mutex_lock(&sConnLock, K_FOREVER);
+  for (size_t i = 0; i < ARRAY_SIZE(scanRequests); i++) {
+    scanRequests[i].active = false;
+  }
+  k_timer_stop(&mScanTimer);
+  mScanning = false;
+  mScanScheduler.Stop(k_uptime_get());
   int err = bt_scan_stop();
+  UpdateAutoConnect();
+  k_mutex_unlock(&sConnLock);
+
   if (err) {
     LOG_ERR("Scanning failed to stop (err %d)", err);
     return chip::System::MapErrorZephyr(err);
@@ -336,76 +971,356 @@ CHIP_ERROR BLEConnectivityManager::StopScan() {
   return CHIP_NO_ERROR;
 }
 
+static void ScanTimeoutWorkEntry(struct k_work *work) {
+  BLEConnectivityManager::Instance().ExpireScanRequests();
+}
+
+static K_WORK_DEFINE(sScanTimeoutWork, ScanTimeoutWorkEntry);
+
 void BLEConnectivityManager::ScanTimeoutCallback(k_timer *timer) {
-  LOG_INF("Scan timeout");
-  Instance().scanState.cb(Instance().scanState.ctx, false, nullptr,
-                          Instance().scanState.serviceUuid);
-  Instance().StopScan();
-}
-
-void BLEConnectivityManager::StopTimer() { k_timer_stop(&mScanTimer); }
-
-int BLEConnectivityManager::ConnectFirstBondedDevice(void *ctx, ScanCallback cb,
-                                                     DeviceFilter filter) {
-  LOG_INF("BLEConnectivityManager::ConnectFirstBondedDevice");
-  bt_addr_le_t addr = bt_addr_le_none;
-
-  if (bt_addr_le_eq(&addr, &bt_addr_le_none)) {
-    LOG_INF("Iterate bonded devices.");
-    bt_foreach_bond(
-        BT_ID_DEFAULT,
-        [](const struct bt_bond_info *info, void *user_data) {
-          memcpy(user_data, &info->addr, sizeof(bt_addr_le_t));
-        },
-        &addr);
-  } else {
-    LOG_INF("Use address of OOB data.");
+  // Timer expiry runs in ISR context, the Bluetooth API must be called from a thread.
+  k_work_submit(&sScanTimeoutWork);
+}
+
+bool BLEConnectivityManager::IsPeerInUse(const bt_addr_le_t *addr) {
+  for (size_t i = 0; i < ARRAY_SIZE(myConnections); i++) {
+    if (myConnections[i].state != connectionInfo::FREE &&
+        bt_addr_le_eq(&myConnections[i].addr, addr)) {
+      return true;
+    }
   }
+  for (size_t i = 0; i < ARRAY_SIZE(acceptList); i++) {
+    if (acceptList[i].active && bt_addr_le_eq(&acceptList[i].addr, addr)) {
+      return true;
+    }
+  }
+  return false;
+}
 
-  if (!bt_addr_le_eq(&addr, &bt_addr_le_none)) {
-    for (size_t i = 0; i < ARRAY_SIZE(myConnections); i++) {
-      if (bt_addr_le_eq(&myConnections[i].addr, &bt_addr_le_none)) {
-        bt_addr_le_copy(&myConnections[i].addr, &addr);
-        myConnections[i].ctx = ctx;
-        myConnections[i].cb = cb;
-
-        switch (filter.type) {
-          case DeviceFilter::FILTER_TYPE_UUID:
-            myConnections[i].serviceUuid = filter.filter.serviceUuid;
-            break;
-          default:
-            LOG_ERR("Not implemented. Only FILTER_TYPE_UUID supported");
-            return 0;
+int BLEConnectivityManager::AutoConnect(void *ctx, ScanCallback cb, DeviceFilter filter,
+                                        const bt_addr_le_t *addr) {
+  LOG_INF("BLEConnectivityManager::AutoConnect");
+
+  if (filter.type != DeviceFilter::FILTER_TYPE_UUID) {
+    LOG_ERR("Not implemented. Only FILTER_TYPE_UUID supported");
+    return 0;
+  }
+
+  struct BondList {
+    bt_addr_le_t addr[kMaxAutoConnectPeers];
+    size_t count;
+  } bonds = {};
+  bt_foreach_bond(
+      BT_ID_DEFAULT,
+      [](const struct bt_bond_info *info, void *user_data) {
+        BondList *bonds = reinterpret_cast<BondList *>(user_data);
+        if (bonds->count < ARRAY_SIZE(bonds->addr)) {
+          bt_addr_le_copy(&bonds->addr[bonds->count++], &info->addr);
         }
+      },
+      &bonds);
+
+  k_mutex_lock(&sConnLock, K_FOREVER);
+  for (size_t i = 0; i < ARRAY_SIZE(acceptList); i++) {
+    if (acceptList[i].active && acceptList[i].ctx == ctx) {
+      acceptList[i].active = false;
+      mAcceptListDirty = true;
+    }
+  }
 
-        Instance().Connect(&myConnections[i].addr);
-        LOG_INF("  ... connect to bonded device");
+  bool radioAvailable = true;
+#if defined(CONFIG_BRIDGE_BROADCAST) && !defined(CONFIG_BT_SCAN_AND_INITIATE_IN_PARALLEL)
+  // Broadcast listeners keep the scanner running, auto-connect would never get the radio. The
+  // caller's scan finds a bonded peer as well.
+  radioAvailable = !IsListening();
+  if (!radioAvailable) {
+    LOG_INF("  ... listening to broadcasts, scan for bonded devices instead");
+  }
+#endif
+
+  int armed = 0;
+  for (size_t b = 0; radioAvailable && b < bonds.count; b++) {
+    if ((addr && !bt_addr_le_eq(addr, &bonds.addr[b])) || IsPeerInUse(&bonds.addr[b])) {
+      continue;
+    }
+    for (size_t i = 0; i < ARRAY_SIZE(acceptList); i++) {
+      if (!acceptList[i].active) {
+        acceptList[i] = {true, bonds.addr[b], filter.filter.serviceUuid, ctx, cb};
+        mAcceptListDirty = true;
+        armed++;
         break;
       }
     }
-    return true;
   }
 
+  if (armed) {
+    if (mBringUpStats.connected == 0 && !mInitiating && !mAutoConnecting) {
+      mBringUpStartMs = k_uptime_get();
+    }
+    LOG_INF("  ... waiting for %d bonded device(s)", armed);
+  }
+  if (mAcceptListDirty) {
+    UpdateAutoConnect();
+  }
+  k_mutex_unlock(&sConnLock);
+
+  return armed;
+}
+
+bool BLEConnectivityManager::CancelAutoConnect(void *ctx) {
+  bool found = false;
+
+  k_mutex_lock(&sConnLock, K_FOREVER);
+  for (size_t i = 0; i < ARRAY_SIZE(acceptList); i++) {
+    if (acceptList[i].active && acceptList[i].ctx == ctx) {
+      acceptList[i].active = false;
+      mAcceptListDirty = true;
+      found = true;
+    }
+  }
+  if (found) {
+    UpdateAutoConnect();
+  }
+  k_mutex_unlock(&sConnLock);
+
+  return found;
+}
+
+#ifdef CONFIG_BRIDGE_BROADCAST
+/****************************
+ * Advertisement listeners
+ ****************************/
+CHIP_ERROR BLEConnectivityManager::Listen(void *ctx, AdvertisementCallback cb,
+                                          const struct bt_uuid *serviceUuid,
+                                          const bt_addr_le_t *addr) {
+  if (serviceUuid->type != BT_UUID_TYPE_128) {
+    LOG_ERR("Broadcast values are only taken from 128 bit service data");
+    return CHIP_ERROR_INVALID_ARGUMENT;
+  }
+
+  k_mutex_lock(&sConnLock, K_FOREVER);
+
+  struct listenInfo *listener = nullptr;
+  for (size_t i = 0; i < ARRAY_SIZE(listeners); i++) {
+    if (listeners[i].active && listeners[i].ctx == ctx) {
+      listener = &listeners[i];
+      break;
+    }
+    if (!listener && !listeners[i].active) {
+      listener = &listeners[i];
+    }
+  }
+
+  if (!listener) {
+    k_mutex_unlock(&sConnLock);
+    LOG_ERR("No free advertisement listener slot");
+    return CHIP_ERROR_NO_MEMORY;
+  }
+
+  listener->active = true;
+  listener->bound = addr != nullptr;
+  bt_addr_le_copy(&listener->addr, addr ? addr : BT_ADDR_LE_ANY);
+  listener->serviceUuid = serviceUuid;
+  listener->lastSequence = -1;
+  listener->ctx = ctx;
+  listener->cb = cb;
+
+  if (!mInitiating) {
+    ResumeScan();
+  }
+  k_mutex_unlock(&sConnLock);
+  return CHIP_NO_ERROR;
+}
+
+void BLEConnectivityManager::StopListening(void *ctx) {
+  k_mutex_lock(&sConnLock, K_FOREVER);
+  for (size_t i = 0; i < ARRAY_SIZE(listeners); i++) {
+    if (listeners[i].ctx == ctx) {
+      listeners[i].active = false;
+    }
+  }
+  if (!mInitiating) {
+    ResumeScan();
+  }
+  k_mutex_unlock(&sConnLock);
+}
+
+bool BLEConnectivityManager::IsListening() {
+  for (size_t i = 0; i < ARRAY_SIZE(listeners); i++) {
+    if (listeners[i].active) {
+      return true;
+    }
+  }
   return false;
 }
 
-int BLEConnectivityManager::Connect(const bt_addr_le_t *addr, const bt_le_conn_param *connParams) {
+BLEConnectivityManager::AdvertisementStats BLEConnectivityManager::GetAdvertisementStats() {
+  k_mutex_lock(&sConnLock, K_FOREVER);
+  AdvertisementStats stats = mAdvertisementStats;
+  k_mutex_unlock(&sConnLock);
+  return stats;
+}
+
+namespace {
+
+struct BroadcastValues {
+  // 128 bit service data, the uuid followed by the values.
+  const uint8_t *serviceData;
+  uint8_t serviceDataLength;
+  // Manufacturer data of kBroadcastCompanyId, without the company id.
+  const uint8_t *manufacturerData;
+  uint8_t manufacturerDataLength;
+};
+
+bool ParseAdvertisingData(struct bt_data *data, void *userData) {
+  BroadcastValues *values = reinterpret_cast<BroadcastValues *>(userData);
+  if (data->type == BT_DATA_SVC_DATA128 && data->data_len > BT_UUID_SIZE_128 &&
+      !values->serviceData) {
+    values->serviceData = data->data;
+    values->serviceDataLength = data->data_len;
+  } else if (data->type == BT_DATA_MANUFACTURER_DATA && data->data_len > sizeof(uint16_t) &&
+             sys_get_le16(data->data) == BLEConnectivityManager::kBroadcastCompanyId) {
+    values->manufacturerData = data->data + sizeof(uint16_t);
+    values->manufacturerDataLength = data->data_len - sizeof(uint16_t);
+  }
+  return true;
+}
+
+// The value records must fill the payload exactly.
+bool AreRecordsValid(const uint8_t *records, uint8_t length) {
+  uint8_t offset = 0;
+  while (offset < length) {
+    if (length - offset < 2 || records[offset + 1] > length - offset - 2) {
+      return false;
+    }
+    offset += 2 + records[offset + 1];
+  }
+  return true;
+}
+
+}  // namespace
+
+void BLEConnectivityManager::HandleAdvertisement(const bt_scan_device_info *deviceInfo) {
+  // Runs for every advertisement in range, so bail out early for the ones without values.
+  BroadcastValues values = {};
+  struct net_buf_simple_state state;
+  net_buf_simple_save(deviceInfo->adv_data, &state);
+  bt_data_parse(deviceInfo->adv_data, ParseAdvertisingData, &values);
+  net_buf_simple_restore(deviceInfo->adv_data, &state);
+  if (!values.serviceData && !values.manufacturerData) {
+    return;
+  }
+
+  const bt_addr_le_t *addr = deviceInfo->recv_info->addr;
+  struct bt_uuid_128 serviceUuid = {};
+  if (values.serviceData) {
+    bt_uuid_create(&serviceUuid.uuid, values.serviceData, BT_UUID_SIZE_128);
+  }
+
+  k_mutex_lock(&sConnLock, K_FOREVER);
+
+  // A listener bound to the advertiser takes precedence over an unbound one.
+  struct listenInfo *listener = nullptr;
+  const uint8_t *payload = nullptr;
+  uint8_t length = 0;
+  for (size_t i = 0; i < ARRAY_SIZE(listeners) && !payload; i++) {
+    struct listenInfo &candidate = listeners[i];
+    if (!candidate.active || !candidate.bound || !bt_addr_le_eq(&candidate.addr, addr)) continue;
+    listener = &candidate;
+    if (values.serviceData && bt_uuid_cmp(&serviceUuid.uuid, candidate.serviceUuid) == 0) {
+      payload = values.serviceData + BT_UUID_SIZE_128;
+      length = values.serviceDataLength - BT_UUID_SIZE_128;
+    } else if (values.manufacturerData) {
+      payload = values.manufacturerData;
+      length = values.manufacturerDataLength;
+    }
+  }
+  for (size_t i = 0; i < ARRAY_SIZE(listeners) && !listener && values.serviceData; i++) {
+    struct listenInfo &candidate = listeners[i];
+    if (candidate.active && !candidate.bound &&
+        bt_uuid_cmp(&serviceUuid.uuid, candidate.serviceUuid) == 0) {
+      listener = &candidate;
+      payload = values.serviceData + BT_UUID_SIZE_128;
+      length = values.serviceDataLength - BT_UUID_SIZE_128;
+    }
+  }
+
+  if (!payload) {
+    k_mutex_unlock(&sConnLock);
+    return;
+  }
+
+  mAdvertisementStats.received++;
+  uint8_t sequence = payload[0];
+  if (listener->lastSequence == sequence) {
+    mAdvertisementStats.duplicates++;
+  } else if (!AreRecordsValid(payload + 1, length - 1)) {
+    mAdvertisementStats.malformed++;
+  } else {
+    if (!listener->bound) {
+      char addrStr[BT_ADDR_LE_STR_LEN];
+      bt_addr_le_to_str(addr, addrStr, sizeof(addrStr));
+      LOG_INF("Broadcasting sensor %s bound", addrStr);
+      listener->bound = true;
+      bt_addr_le_copy(&listener->addr, addr);
+    }
+    listener->lastSequence = sequence;
+    // Called with the lock held, so StopListening guarantees that no callback is running anymore.
+    // The callback only hands the values on to the CHIP thread.
+    listener->cb(listener->ctx, addr, deviceInfo->recv_info->rssi, payload + 1, length - 1);
+  }
+  k_mutex_unlock(&sConnLock);
+}
+#endif
+
+void BLEConnectivityManager::NoteReconnected(uint32_t reconnectMs) {
+  mReconnectStats.reconnects++;
+  mReconnectStats.lastReconnectMs = reconnectMs;
+  mReconnectStats.maxReconnectMs = MAX(mReconnectStats.maxReconnectMs, reconnectMs);
+}
+
+void BLEConnectivityManager::RadioStart(int64_t &startMs) { startMs = k_uptime_get(); }
+
+void BLEConnectivityManager::RadioStop(int64_t &startMs, uint32_t &totalMs) {
+  if (startMs >= 0) {
+    totalMs += k_uptime_get() - startMs;
+    startMs = -1;
+  }
+}
+
+BLEConnectivityManager::RadioStats BLEConnectivityManager::GetRadioStats() {
+  k_mutex_lock(&sConnLock, K_FOREVER);
+  RadioStats stats = mRadioStats;
+  int64_t now = k_uptime_get();
+  // Include the running activities.
+  ScanScheduler::Stats scan = mScanScheduler.GetStats(now);
+  if (mInitiateStartMs >= 0) stats.initiateMs += now - mInitiateStartMs;
+  if (mAutoConnectStartMs >= 0) stats.autoConnectMs += now - mAutoConnectStartMs;
+  k_mutex_unlock(&sConnLock);
+
+  stats.scanMs = scan.scanMs;
+  stats.activeScanMs = scan.activeScanMs;
+  stats.scanRadioOnMs = scan.radioOnMs;
+  stats.scanParameterChanges = scan.parameterChanges;
+  stats.radioOnMs =
+      scan.radioOnMs +
+      (uint64_t)stats.initiateMs * create_param->window / create_param->interval +
+      (uint64_t)stats.autoConnectMs * kAutoConnectParam.window / kAutoConnectParam.interval;
+  return stats;
+}
+
+int BLEConnectivityManager::Connect(struct connectionInfo &connection) {
   char addrS[BT_ADDR_LE_STR_LEN];
-  bt_addr_le_to_str(addr, addrS, sizeof(addrS));
+  bt_addr_le_to_str(&connection.addr, addrS, sizeof(addrS));
   LOG_INF("BLEConnectivityManager::Connect to addr %s", addrS);
 
   bt_conn *conn;
-  int err = bt_conn_le_create(addr, create_param, connParams, &conn);
+  int err = bt_conn_le_create(&connection.addr, create_param, &connection.connParam, &conn);
 
   if (err) {
     LOG_ERR("Creating connection failed (err %d)", err);
   } else {
-    for (size_t i = 0; i < ARRAY_SIZE(myConnections); i++) {
-      if (bt_addr_le_eq(&myConnections[i].addr, addr)) {
-        myConnections[i].conn = conn;
-        break;
-      }
-    }
+    connection.conn = conn;
   }
 
   return err;
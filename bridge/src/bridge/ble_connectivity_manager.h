@@ -6,32 +6,120 @@
 #include <zephyr/bluetooth/conn.h>
 #include <zephyr/kernel.h>
 
+#include "candidate_ranking.h"
+#include "scan_scheduler.h"
+
 class MatterDevice;
 
 class BLEConnectivityManager {
  public:
   static constexpr uint16_t kScanTimeoutMs = 10000;
+  static constexpr uint8_t kMaxScanRequests = CONFIG_BT_MAX_CONN;
+  static constexpr uint8_t kMaxAutoConnectPeers = CONFIG_BT_MAX_PAIRED;
+  // Time advertisers matching a request are collected before the best one is connected, 0 connects
+  // to the first match.
+  static constexpr uint16_t kCandidateWindowMs = CONFIG_BRIDGE_BT_CANDIDATE_WINDOW_MS;
+  static constexpr uint8_t kMaxCandidates = CONFIG_BRIDGE_BT_MAX_CANDIDATES;
 
   using ScanCallback = void (*)(void *ctx, bool connected, struct bt_conn *conn,
-                                struct bt_uuid *serviceUuid);
+                                const struct bt_uuid *serviceUuid);
 
   struct DeviceFilter {
     enum { FILTER_TYPE_NAME, FILTER_TYPE_UUID, FILTER_TYPE_ADDR } type;
     union {
       char name[16];
-      struct bt_uuid *serviceUuid;
+      const struct bt_uuid *serviceUuid;
       bt_addr_le_t deviceAddress;
     } filter;
   };
 
+  struct BringUpStats {
+    uint8_t connected;
+    uint32_t connectFailures;
+    // Connections that failed and went on with the next ranked candidate instead.
+    uint32_t candidateFallbacks;
+    // Time from the first scan request while nothing was connected to the latest connection.
+    uint32_t lastBringUpMs;
+  };
+
+  struct ReconnectStats {
+    uint32_t attempts;
+    uint32_t reconnects;
+    // Time from losing a connection until the device was connected again.
+    uint32_t lastReconnectMs;
+    uint32_t maxReconnectMs;
+  };
+
+  // Time the radio was busy on behalf of the bridged devices. Scanning, initiating and auto-connect
+  // are counted while active, radioOnMs weights them with their scan window / interval ratio.
+  // scanRadioOnMs is the share of scanning, with the duty cycles the ScanScheduler picked.
+  struct RadioStats {
+    uint32_t scanMs;
+    uint32_t initiateMs;
+    uint32_t autoConnectMs;
+    uint32_t radioOnMs;
+    uint32_t activeScanMs;
+    uint32_t scanRadioOnMs;
+    uint32_t scanParameterChanges;
+  };
+
+#ifdef CONFIG_BRIDGE_BROADCAST
+  static constexpr uint8_t kMaxAdvertisementListeners = CONFIG_BRIDGE_BROADCAST_DEVICES;
+  static constexpr uint16_t kBroadcastCompanyId = CONFIG_BRIDGE_BROADCAST_COMPANY_ID;
+
+  // Called on the BT RX thread with the value records of a new advertisement, see Listen.
+  using AdvertisementCallback = void (*)(void *ctx, const bt_addr_le_t *addr, int8_t rssi,
+                                         const uint8_t *records, uint8_t length);
+
+  // received counts advertisements with values for a listener, duplicates those repeating the
+  // previous sequence number and malformed those with broken value records.
+  struct AdvertisementStats {
+    uint32_t received;
+    uint32_t duplicates;
+    uint32_t malformed;
+  };
+#endif
+
   CHIP_ERROR Init();
+  // Add a scan request. Requests of different contexts are active in the same scan, a new request
+  // of the same context replaces the previous one.
   CHIP_ERROR Scan(void *ctx, ScanCallback cb, DeviceFilter filter,
                   uint32_t scanTimeoutMs = kScanTimeoutMs);
   CHIP_ERROR StopScan();
-  int Connect(const bt_addr_le_t *addr, const bt_le_conn_param *connParams = BT_LE_CONN_PARAM_DEFAULT);
-  int ConnectFirstBondedDevice(void *ctx, ScanCallback cb, DeviceFilter filter);
-  
-  void StopTimer();
+  CHIP_ERROR StopScan(void *ctx);
+  // Wait for a bonded peer with accept list auto-connect, which the controller runs without any
+  // host scan traffic. With addr == nullptr all bonded peers that are not in use are waited for.
+  // A new request of the same context replaces the previous one. Returns the number of peers, 0
+  // while broadcast listeners keep the scanner busy and auto-connect could not run.
+  int AutoConnect(void *ctx, ScanCallback cb, DeviceFilter filter,
+                  const bt_addr_le_t *addr = nullptr);
+  // Returns false if the context had no pending auto-connect, e.g. because it just connected.
+  bool CancelAutoConnect(void *ctx);
+#ifdef CONFIG_BRIDGE_BROADCAST
+  // Take the values of a sensor from its advertisements instead of a connection. Scanning goes on
+  // as long as listeners are registered. With addr == nullptr the listener binds to the first
+  // advertiser with service data of serviceUuid that no other listener is bound to.
+  //
+  // The values are carried either as service data of serviceUuid (128 bit) or, once the listener
+  // knows the address, as manufacturer data of kBroadcastCompanyId:
+  //   [uuid (16) | company id (2)] [sequence (1)] {[index (1)] [length (1)] [value (length)]}
+  // The sensor increments the sequence number with every new set of values and repeats it while
+  // the values do not change, repetitions are dropped here. index is the characteristic of the
+  // listener's profile the value belongs to. Sensors must use an identity address.
+  CHIP_ERROR Listen(void *ctx, AdvertisementCallback cb, const struct bt_uuid *serviceUuid,
+                    const bt_addr_le_t *addr = nullptr);
+  void StopListening(void *ctx);
+  AdvertisementStats GetAdvertisementStats();
+#endif
+
+  // CHIPoBLE advertising started or stopped. Scanning backs off while it runs, see ScanScheduler.
+  void SetAdvertising(bool advertising);
+
+  BringUpStats GetBringUpStats() const { return mBringUpStats; }
+  RadioStats GetRadioStats();
+  ReconnectStats GetReconnectStats() const { return mReconnectStats; }
+  void NoteReconnectAttempt() { mReconnectStats.attempts++; }
+  void NoteReconnected(uint32_t reconnectMs);
 
   static BLEConnectivityManager &Instance() {
     static BLEConnectivityManager sInstance;
@@ -40,43 +128,128 @@ class BLEConnectivityManager {
 
   static void SecurityChangedHandler(struct bt_conn *conn, bt_security_t level,
                                      enum bt_security_err err);
+  static void ParamUpdatedHandler(struct bt_conn *conn, uint16_t interval, uint16_t latency,
+                                  uint16_t timeout);
   static void IdentityResolvedHandler(struct bt_conn *conn, const bt_addr_le_t *rpa,
                                       const bt_addr_le_t *identity);
   static void DisconnectionHandler(bt_conn *conn, uint8_t reason);
   static void ConnectionHandler(bt_conn *conn, uint8_t conn_err);
   static void ScanResultCallback(bt_scan_device_info *device_info,
                                  bt_scan_filter_match *filter_match, bool connectable);
+  static void ScanNoMatchCallback(bt_scan_device_info *device_info, bool connectable);
   static void Connecting(struct bt_scan_device_info *device_info, struct bt_conn *conn);
 
   static void ScanTimeoutCallback(k_timer *timer);
+  // Connects the requests whose candidate window closed and fails the ones that timed out.
+  void ExpireScanRequests();
 
   struct connectionInfo {
+    enum { FREE, QUEUED, CONNECTING, CONNECTED } state = FREE;
     struct bt_conn *conn;
     bt_addr_le_t addr = bt_addr_le_none;
-    struct bt_uuid *serviceUuid;     
+    bt_le_conn_param connParam;
+    const struct bt_uuid *serviceUuid;
     void *ctx;
     ScanCallback cb;
+    // Candidates of the request to try next if this connection cannot be established, best first.
+    bt_addr_le_t fallbacks[kMaxCandidates];
+    uint8_t fallbackCount = 0;
   };
 
   struct scanInfo {
-    bool scanning;
-    struct bt_uuid *serviceUuid;
+    bool active;
+    DeviceFilter filter;
+    int64_t deadline;
     void *ctx;
     ScanCallback cb;
+    // Advertisers matching the request, collected until selectDeadline.
+    CandidateRanking::Candidate candidates[kMaxCandidates];
+    uint8_t candidateCount;
+    int64_t selectDeadline;
   };  
 
   // The purpose of this struct is 
   //   - to have the context, callback and service uuid during the (Dis)connected callbacks.
   //   - to react only to (dis)connects that were initiated by the bridge manager.
+  //   - to queue matches until the controller is free to initiate the next connection.
+  struct autoConnectInfo {
+    bool active;
+    bt_addr_le_t addr;
+    const struct bt_uuid *serviceUuid;
+    void *ctx;
+    ScanCallback cb;
+  };
+
+#ifdef CONFIG_BRIDGE_BROADCAST
+  struct listenInfo {
+    bool active;
+    // Unbound listeners take the first advertiser with matching service data.
+    bool bound;
+    bt_addr_le_t addr;
+    const struct bt_uuid *serviceUuid;
+    // -1 until the first advertisement was accepted.
+    int16_t lastSequence;
+    void *ctx;
+    AdvertisementCallback cb;
+  };
+#endif
+
   struct connectionInfo myConnections[CONFIG_BT_MAX_CONN];
-  struct scanInfo scanState;
+  struct scanInfo scanRequests[kMaxScanRequests];
+  // Peers in the controller's accept list.
+  struct autoConnectInfo acceptList[kMaxAutoConnectPeers];
+#ifdef CONFIG_BRIDGE_BROADCAST
+  struct listenInfo listeners[kMaxAdvertisementListeners];
+#endif
 
  private:
-  CHIP_ERROR PrepareFilterForUuid(bt_uuid *serviceUuid);
-  CHIP_ERROR PrepareFilterForAddr(bt_addr_le_t *addr);
+  CHIP_ERROR ApplyScanFilters();
+  void UpdateScanTimer();
+  static bool MatchesScanRequest(const struct scanInfo &request,
+                                 const bt_scan_filter_match *filterMatch,
+                                 const bt_addr_le_t *addr);
+  struct scanInfo *FindScanRequest(bt_scan_filter_match *filterMatch, const bt_addr_le_t *addr);
+  void AddCandidate(const bt_scan_device_info *deviceInfo, bt_scan_filter_match *filterMatch);
+  bool SelectCandidate(struct scanInfo &request);
+  struct connectionInfo *QueueConnection(const bt_addr_le_t *addr,
+                                         const bt_le_conn_param *connParams, void *ctx,
+                                         ScanCallback cb, const struct bt_uuid *serviceUuid);
+  bool RetryWithFallback(struct connectionInfo &connection);
+  void ProcessConnectQueue();
+  void ResumeScan();
+  ScanScheduler::Conditions GetScanConditions();
+  int StartScanning();
+  // Restarts a running scan if the conditions call for other parameters.
+  void UpdateScanParameters();
+  int Connect(struct connectionInfo &connection);
+  bool IsPeerInUse(const bt_addr_le_t *addr);
+  void UpdateAutoConnect();
+  void StopAutoConnect();
+  void HandleAutoConnection(bt_conn *conn, uint8_t connErr);
+#ifdef CONFIG_BRIDGE_BROADCAST
+  void HandleAdvertisement(const bt_scan_device_info *deviceInfo);
+  bool IsListening();
+#endif
+  static void RadioStart(int64_t &startMs);
+  static void RadioStop(int64_t &startMs, uint32_t &totalMs);
 
   const struct bt_conn_le_create_param *create_param = BT_CONN_LE_CREATE_CONN;
 
   k_timer mScanTimer;
-  bt_uuid mServiceUuid;
+  bool mScanning = false;
+  ScanScheduler mScanScheduler;
+  bool mAdvertising = false;
+  bool mInitiating = false;
+  bool mAutoConnecting = false;
+  // The accept list in the controller must be rewritten before auto-connect is started again.
+  bool mAcceptListDirty = false;
+  int64_t mBringUpStartMs = -1;
+  BringUpStats mBringUpStats = {};
+  ReconnectStats mReconnectStats = {};
+  RadioStats mRadioStats = {};
+#ifdef CONFIG_BRIDGE_BROADCAST
+  AdvertisementStats mAdvertisementStats = {};
+#endif
+  int64_t mInitiateStartMs = -1;
+  int64_t mAutoConnectStartMs = -1;
 };
@@ -17,10 +17,13 @@
 #include <zephyr/bluetooth/uuid.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/byteorder.h>
 
 #include <map>
 #include <utility>
 
+#include "bridge_trace.h"
 #include "matter_device.h"
 LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
 
@@ -43,49 +46,162 @@ static void DiscoveryCompletedHandlerEntry(bt_gatt_dm *dm, void *context) {
 
 static uint8_t SubscriptionHandlerEntry(bt_conn *conn, bt_gatt_subscribe_params *params,
                                         const void *data, uint16_t length) {
-  BleDevice *dev = BleDevice::Instance(conn);
-  dev->SubscriptionHandler(conn, params, data, length);
+  auto *sub = CONTAINER_OF(params, BleDevice::Subscription, params);
+  sub->dev->SubscriptionHandler(sub, data, length);
   return BT_GATT_ITER_CONTINUE;
 }
 
-static uint8_t GATTReadCallbackEntry(bt_conn *conn, uint8_t att_err, bt_gatt_read_params *params,
-                                     const void *data, uint16_t read_len) {
+static uint8_t PendingReadHandlerEntry(bt_conn *conn, uint8_t att_err,
+                                       bt_gatt_read_params *params, const void *data,
+                                       uint16_t read_len) {
+  auto *read = CONTAINER_OF(params, BleDevice::PendingRead, params);
+  read->dev->PendingReadHandler(read, att_err, data, read_len);
+  return BT_GATT_ITER_STOP;
+}
+
+static uint8_t ReadMultipleCallbackEntry(bt_conn *conn, uint8_t att_err,
+                                         bt_gatt_read_params *params, const void *data,
+                                         uint16_t read_len) {
   BleDevice *dev = BleDevice::Instance(conn);
-  dev->GATTReadCallback(conn, att_err, params, data, read_len);
+  return dev->ReadMultipleCallback(att_err, data, read_len);
+}
+
+static uint8_t BatchReadCallbackEntry(bt_conn *conn, uint8_t att_err, bt_gatt_read_params *params,
+                                      const void *data, uint16_t read_len) {
+  BleDevice *dev = BleDevice::Instance(conn);
+  dev->BatchReadCallback(params, att_err, data, read_len);
   return BT_GATT_ITER_STOP;
 }
 
+static uint8_t DatabaseHashReadCallbackEntry(bt_conn *conn, uint8_t att_err,
+                                             bt_gatt_read_params *params, const void *data,
+                                             uint16_t read_len) {
+  BleDevice *dev = BleDevice::Instance(conn);
+  dev->DatabaseHashReadCallback(conn, att_err, data, read_len);
+  return BT_GATT_ITER_STOP;
+}
+
+static void WriteResponseEntry(bt_conn *conn, uint8_t att_err, bt_gatt_write_params *params) {
+  auto *write = CONTAINER_OF(params, BleDevice::PendingWrite, params);
+  write->dev->CompleteWrite(write, att_err ? -EIO : 0);
+}
+
+static void WriteSentEntry(bt_conn *conn, void *user_data) {
+  auto *write = reinterpret_cast<BleDevice::PendingWrite *>(user_data);
+  write->dev->CompleteWrite(write, 0);
+}
+
 static const struct bt_gatt_dm_cb discovery_cb = {.completed = DiscoveryCompletedHandlerEntry,
                                                   .service_not_found = DiscoveryNotFoundEntry,
                                                   .error_found = DiscoveryErrorEntry};
 
-uint16_t BleDevice::findHandleByUuid(struct bt_uuid *uuid) {
-  auto findResult = std::find_if(std::begin(mHandleToUuid), std::end(mHandleToUuid),
-                                 [&](const std::pair<uint16_t, struct bt_uuid *> &pair) {
-                                   return bt_uuid_cmp(uuid, pair.second) == 0;
-                                 });
+uint8_t BleDevice::HashUuid(const struct bt_uuid *uuid) {
+  uint32_t h = 2166136261u;
+  switch (uuid->type) {
+    case BT_UUID_TYPE_16:
+      h = (h ^ BT_UUID_16(uuid)->val) * 16777619u;
+      break;
+    case BT_UUID_TYPE_32:
+      h = (h ^ BT_UUID_32(uuid)->val) * 16777619u;
+      break;
+    default:
+      for (uint8_t i = 0; i < BT_UUID_SIZE_128; i++) {
+        h = (h ^ BT_UUID_128(uuid)->val[i]) * 16777619u;
+      }
+      break;
+  }
+  return (h ^ (h >> 16)) % kUuidIndexSize;
+}
+
+bool BleDevice::AddHandle(uint16_t handle, const struct bt_uuid *uuid, uint8_t properties) {
+  VerifyOrReturnValue(mHandleCount < kMaxAttributes, false,
+                      LOG_ERR("Handle table full, drop handle %d", handle));
+  VerifyOrReturnValue(mHandleCount == 0 || mHandles[mHandleCount - 1].handle < handle, false,
+                      LOG_ERR("Handle %d out of order", handle));
+
+  HandleEntry &entry = mHandles[mHandleCount];
+  entry.handle = handle;
+  entry.properties = properties;
+  switch (uuid->type) {
+    case BT_UUID_TYPE_16:
+      entry.uuid.u16 = *BT_UUID_16(uuid);
+      break;
+    case BT_UUID_TYPE_32:
+      entry.uuid.u32 = *BT_UUID_32(uuid);
+      break;
+    case BT_UUID_TYPE_128:
+      entry.uuid.u128 = *BT_UUID_128(uuid);
+      break;
+    default:
+      return false;
+  }
+  mHandleCount++;
+
+  // Index the first occurrence only, repeated UUIDs (e.g. CCCDs) are found relative to a handle.
+  uint8_t slot = HashUuid(uuid);
+  while (mUuidIndex[slot] != 0) {
+    if (bt_uuid_cmp(&mHandles[mUuidIndex[slot] - 1].uuid.uuid, uuid) == 0) {
+      return true;
+    }
+    slot = (slot + 1) % kUuidIndexSize;
+  }
+  mUuidIndex[slot] = mHandleCount;
+  return true;
+}
+
+int BleDevice::FindEntry(uint16_t handle) {
+  int low = 0;
+  int high = mHandleCount - 1;
+  while (low <= high) {
+    int mid = (low + high) / 2;
+    if (mHandles[mid].handle == handle) {
+      return mid;
+    } else if (mHandles[mid].handle < handle) {
+      low = mid + 1;
+    } else {
+      high = mid - 1;
+    }
+  }
+  return -1;
+}
 
+uint16_t BleDevice::findHandleByUuid(const struct bt_uuid *uuid) {
   uint16_t foundKey = 0;
-  if (findResult != std::end(mHandleToUuid)) {
-    foundKey = findResult->first;
+
+  uint8_t slot = HashUuid(uuid);
+  while (mUuidIndex[slot] != 0) {
+    const HandleEntry &entry = mHandles[mUuidIndex[slot] - 1];
+    if (bt_uuid_cmp(&entry.uuid.uuid, uuid) == 0) {
+      foundKey = entry.handle;
+      break;
+    }
+    slot = (slot + 1) % kUuidIndexSize;
   }
 
-  char str[BT_UUID_STR_LEN];
-  bt_uuid_to_str(uuid, str, sizeof(str));
-  LOG_INF("Found handle %d for uuid %s", foundKey, str);
+  LOG_DBG("Found handle %d", foundKey);
   return foundKey;
 }
 
-uint16_t BleDevice::findNextCccdHandleByUuid(uint16_t attrHandle) {
-  struct bt_uuid_16 cccd = BT_UUID_INIT_16(BT_UUID_GATT_CCC_VAL);
-  auto findResult = std::find_if(mHandleToUuid.lower_bound(attrHandle), std::end(mHandleToUuid),
-                                 [&](const std::pair<uint16_t, struct bt_uuid *> &pair) {
-                                   return bt_uuid_cmp((bt_uuid *)&cccd, pair.second) == 0;
-                                 });
+struct bt_uuid *BleDevice::findUuidByHandle(uint16_t handle) {
+  int idx = FindEntry(handle);
+  return idx < 0 ? nullptr : &mHandles[idx].uuid.uuid;
+}
 
+uint16_t BleDevice::findNextCccdHandleByUuid(uint16_t attrHandle) {
   uint16_t foundKey = 0;
-  if (findResult != std::end(mHandleToUuid)) {
-    foundKey = findResult->first;
+
+  int idx = FindEntry(attrHandle);
+  if (idx >= 0) {
+    // The CCCD belongs to the characteristic, stop at the next characteristic declaration.
+    for (uint8_t i = idx + 1; i < mHandleCount; i++) {
+      if (bt_uuid_cmp(&mHandles[i].uuid.uuid, BT_UUID_GATT_CCC) == 0) {
+        foundKey = mHandles[i].handle;
+        break;
+      }
+      if (bt_uuid_cmp(&mHandles[i].uuid.uuid, BT_UUID_GATT_CHRC) == 0) {
+        break;
+      }
+    }
   }
 
   LOG_INF("Found cccd handle %d for attr handle %d", foundKey, attrHandle);
@@ -96,27 +212,33 @@ void BleDevice::DiscoveryCompletedHandler(bt_gatt_dm *dm, void *context) {
   LOG_INF("The GATT discovery completed");
   bt_gatt_dm_data_print(dm);
 
-  BleDevice *dev = BleDevice::Instance(bt_gatt_dm_conn_get(dm));
-
+  // A characteristic declaration precedes its value, remember its properties for the value.
   const struct bt_gatt_dm_attr *attr = NULL;
+  uint16_t valueHandle = 0;
+  uint8_t properties = 0;
   while (NULL != (attr = bt_gatt_dm_attr_next(dm, attr))) {
-    if (attr->uuid->type == BT_UUID_TYPE_16) {
-      auto *uuid = chip::Platform::New<bt_uuid_16>();
-      *uuid = *(BT_UUID_16(attr->uuid));
-      mHandleToUuid[attr->handle] = reinterpret_cast<bt_uuid *>(uuid);
-    } else if (attr->uuid->type == BT_UUID_TYPE_32) {
-      auto *uuid = chip::Platform::New<bt_uuid_32>();
-      *uuid = *(BT_UUID_32(attr->uuid));
-      mHandleToUuid[attr->handle] = reinterpret_cast<bt_uuid *>(uuid);
-    } else if (attr->uuid->type == BT_UUID_TYPE_128) {
-      auto *uuid = chip::Platform::New<bt_uuid_128>();
-      *uuid = *(BT_UUID_128(attr->uuid));
-      mHandleToUuid[attr->handle] = reinterpret_cast<bt_uuid *>(uuid);
+    if (bt_uuid_cmp(attr->uuid, BT_UUID_GATT_CHRC) == 0) {
+      const struct bt_gatt_chrc *chrc = bt_gatt_dm_attr_chrc_val(attr);
+      valueHandle = chrc ? chrc->value_handle : 0;
+      properties = chrc ? chrc->properties : 0;
     }
+    AddHandle(attr->handle, attr->uuid, attr->handle == valueHandle ? properties : 0);
   }
 
   bt_gatt_dm_data_release(dm);
 
+  // Remember the handles of bonded peers together with their Database Hash.
+  if (IS_ENABLED(CONFIG_BRIDGE_GATT_CACHE) && IsBonded()) {
+    mVerifyingGattCache = false;
+    ReadDatabaseHash();
+  }
+
+  CompleteDiscovery();
+}
+
+void BleDevice::CompleteDiscovery() {
+  LOG_INF("Discovery done after %lld ms", k_uptime_get() - mDiscoveryStartMs);
+
   chip::DeviceLayer::PlatformMgr().ScheduleWork(
       [](intptr_t context) {
         BleDevice *dev = reinterpret_cast<BleDevice *>(context);
@@ -124,7 +246,7 @@ void BleDevice::DiscoveryCompletedHandler(bt_gatt_dm *dm, void *context) {
         dev->mDisCb.dev = NULL;
         dev->mDisCb.cb = NULL;
       },
-      reinterpret_cast<intptr_t>(dev));
+      reinterpret_cast<intptr_t>(this));
 }
 
 void BleDevice::DiscoveryNotFound(bt_conn *conn, void *context) {
@@ -141,7 +263,7 @@ void BleDevice::DiscoveryError(bt_conn *conn, int err, void *context) {
   Disconnect();  
 }
 
-void BleDevice::Discover(void *ctx, DiscoveryCallback cb, struct bt_uuid *serviceUuid) {
+void BleDevice::Discover(void *ctx, DiscoveryCallback cb, const struct bt_uuid *serviceUuid) {
   if (mDisCb.dev) {
     LOG_ERR("Discovery already ongoing.");
   } else {
@@ -151,29 +273,225 @@ void BleDevice::Discover(void *ctx, DiscoveryCallback cb, struct bt_uuid *servic
 
     mDisCb.dev = ctx;
     mDisCb.cb = cb;
+    mServiceUuid = serviceUuid;
+    mDiscoveryStartMs = k_uptime_get();
+
+    if (mLink) {
+      UpdatePhyAndDataLength();
+      UpdateConnectionParameters(mLink->discovery, "discovery");
+    }
 
-    int err = bt_gatt_dm_start(mConn, serviceUuid, &discovery_cb, (void *)this);
+    // Bonded peer with an unchanged database: reuse the stored handles.
+    if (IS_ENABLED(CONFIG_BRIDGE_GATT_CACHE) && IsBonded() && LoadGattCache()) {
+      mVerifyingGattCache = true;
+      ReadDatabaseHash();
+      return;
+    }
+
+    StartFullDiscovery();
+  }
+}
+
+void BleDevice::StartFullDiscovery() {
+  int err = bt_gatt_dm_start(mConn, mServiceUuid, &discovery_cb, (void *)this);
+  if (err) {
+    LOG_ERR(
+        "Could not start the discovery procedure, error "
+        "code: %d",
+        err);
+  }
+}
+
+/****************************
+ * Link profile
+ ****************************/
+void BleDevice::UpdatePhyAndDataLength() {
+#ifdef CONFIG_BT_USER_PHY_UPDATE
+  if (mLink->phy != BT_GAP_LE_PHY_NONE) {
+    const struct bt_conn_le_phy_param phy = {
+        .options = BT_CONN_LE_PHY_OPT_NONE, .pref_tx_phy = mLink->phy, .pref_rx_phy = mLink->phy};
+    int err = bt_conn_le_phy_update(mConn, &phy);
+    if (err) {
+      LOG_WRN("PHY update failed (err %d)", err);
+    }
+  }
+#endif
+#ifdef CONFIG_BT_USER_DATA_LEN_UPDATE
+  if (mLink->maxTxOctets) {
+    const struct bt_conn_le_data_len_param dataLength = {.tx_max_len = mLink->maxTxOctets,
+                                                         .tx_max_time = BT_GAP_DATA_TIME_MAX};
+    int err = bt_conn_le_data_len_update(mConn, &dataLength);
     if (err) {
-      LOG_ERR(
-          "Could not start the discovery procedure, error "
-          "code: %d",
-          err);
+      LOG_WRN("Data length update failed (err %d)", err);
     }
   }
+#endif
 }
 
-void BleDevice::SubscriptionHandler(bt_conn *conn, bt_gatt_subscribe_params *params,
-                                    const void *data, uint16_t length) {
-  // subscriptions of bonded devices survive a disconnect
-  if (mHandleToUuid[params->value_handle] != nullptr) {
-    char str[BT_UUID_STR_LEN];
-    bt_uuid_to_str(mHandleToUuid[params->value_handle], str, sizeof(str));
-    LOG_INF("Subscription handler for uuid %s (handle %d): ", str, params->value_handle);
-    LOG_HEXDUMP_INF(data, length, "Subscription data");
+void BleDevice::UpdateConnectionParameters(const bt_le_conn_param &param, const char *phase) {
+  LOG_INF("Request %s connection parameters: interval %u-%u, latency %u, timeout %u", phase,
+          param.interval_min, param.interval_max, param.latency, param.timeout);
+  // As central the parameters are updated right away, -EALREADY if they are in use already.
+  int err = bt_conn_le_param_update(mConn, &param);
+  if (err && err != -EALREADY) {
+    LOG_WRN("Connection parameter update failed (err %d)", err);
+  }
+}
 
-    auto subCb = mSubCbs[params];
-    if (subCb.second != nullptr)
-      subCb.second(subCb.first, mHandleToUuid[params->value_handle], data, length);
+void BleDevice::ApplyIdleLinkProfile() {
+  // Set up, from now on only notifications and the odd read or write.
+  if (mLink) {
+    UpdateConnectionParameters(mLink->idle, "idle");
+  }
+}
+
+/****************************
+ * Discovery cache
+ ****************************/
+bool BleDevice::IsBonded() {
+  struct BondLookup {
+    const bt_addr_le_t *addr;
+    bool found;
+  } lookup = {bt_conn_get_dst(mConn), false};
+
+  bt_foreach_bond(
+      BT_ID_DEFAULT,
+      [](const struct bt_bond_info *info, void *user_data) {
+        auto *lookup = reinterpret_cast<BondLookup *>(user_data);
+        if (bt_addr_le_eq(&info->addr, lookup->addr)) lookup->found = true;
+      },
+      &lookup);
+
+  return lookup.found;
+}
+
+void BleDevice::GattCacheKey(const bt_addr_le_t *addr, char *key, size_t size) {
+  snprintk(key, size, "bridge/gatt/%02x%02x%02x%02x%02x%02x%02x", addr->type, addr->a.val[5],
+           addr->a.val[4], addr->a.val[3], addr->a.val[2], addr->a.val[1], addr->a.val[0]);
+}
+
+void BleDevice::DeleteGattCache(const bt_addr_le_t *peer) {
+  char key[32];
+  GattCacheKey(peer, key, sizeof(key));
+  int err = settings_delete(key);
+  LOG_INF("Deleted GATT cache %s (err %d)", key, err);
+}
+
+bool BleDevice::LoadGattCache() {
+  char key[32];
+  GattCacheKey(bt_conn_get_dst(mConn), key, sizeof(key));
+
+  struct CacheLoad {
+    GattCache *cache;
+    bool loaded;
+  } load = {&mGattCache, false};
+
+  settings_load_subtree_direct(
+      key,
+      [](const char *key, size_t len, settings_read_cb read_cb, void *cb_arg, void *param) -> int {
+        auto *load = reinterpret_cast<CacheLoad *>(param);
+        if (len > sizeof(GattCache) || len < offsetof(GattCache, records)) {
+          return 0;
+        }
+        ssize_t read = read_cb(cb_arg, load->cache, len);
+        load->loaded =
+            read == (ssize_t)(offsetof(GattCache, records) +
+                              load->cache->count * sizeof(GattCacheRecord)) &&
+            load->cache->count <= kMaxAttributes;
+        return 0;
+      },
+      &load);
+
+  LOG_INF("GATT cache %s for %s", load.loaded ? "found" : "not found", key);
+  return load.loaded;
+}
+
+void BleDevice::RestoreGattCache() {
+  for (uint8_t i = 0; i < mGattCache.count; i++) {
+    const GattCacheRecord &record = mGattCache.records[i];
+    UuidStorage uuid;
+    if (bt_uuid_create(&uuid.uuid, record.uuid, record.uuidLength)) {
+      AddHandle(record.handle, &uuid.uuid, record.properties);
+    }
+  }
+}
+
+void BleDevice::ReadDatabaseHash() {
+  mHashReadParams.func = DatabaseHashReadCallbackEntry;
+  mHashReadParams.handle_count = 0;
+  mHashReadParams.by_uuid.uuid = BT_UUID_GATT_DB_HASH;
+  mHashReadParams.by_uuid.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+  mHashReadParams.by_uuid.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+
+  int err = bt_gatt_read(mConn, &mHashReadParams);
+  if (err) {
+    LOG_ERR("Database Hash read failed (err %d)", err);
+    if (mVerifyingGattCache) {
+      mVerifyingGattCache = false;
+      StartFullDiscovery();
+    }
+  }
+}
+
+void BleDevice::DatabaseHashReadCallback(bt_conn *conn, uint8_t att_err, const void *data,
+                                         uint16_t read_len) {
+  bool valid = !att_err && data && read_len == GATT_DB_HASH_SIZE;
+
+  if (mVerifyingGattCache) {
+    mVerifyingGattCache = false;
+    if (valid && memcmp(mGattCache.hash, data, GATT_DB_HASH_SIZE) == 0) {
+      LOG_INF("Database Hash unchanged. Use cached handles.");
+      RestoreGattCache();
+      CompleteDiscovery();
+    } else {
+      LOG_INF("Database Hash changed or unavailable. Discover.");
+      StartFullDiscovery();
+    }
+    return;
+  }
+
+  VerifyOrReturn(valid, LOG_INF("Peer has no Database Hash (err %d). Do not cache.", att_err));
+
+  memcpy(mGattCache.hash, data, GATT_DB_HASH_SIZE);
+  mGattCache.count = 0;
+  for (uint8_t i = 0; i < mHandleCount; i++) {
+    const struct bt_uuid *uuid = &mHandles[i].uuid.uuid;
+    GattCacheRecord &record = mGattCache.records[mGattCache.count++];
+    record.handle = mHandles[i].handle;
+    record.properties = mHandles[i].properties;
+    if (uuid->type == BT_UUID_TYPE_16) {
+      record.uuidLength = BT_UUID_SIZE_16;
+      sys_put_le16(BT_UUID_16(uuid)->val, record.uuid);
+    } else if (uuid->type == BT_UUID_TYPE_32) {
+      record.uuidLength = BT_UUID_SIZE_32;
+      sys_put_le32(BT_UUID_32(uuid)->val, record.uuid);
+    } else {
+      record.uuidLength = BT_UUID_SIZE_128;
+      memcpy(record.uuid, BT_UUID_128(uuid)->val, BT_UUID_SIZE_128);
+    }
+  }
+
+  // Flash writes do not belong into the BT RX thread.
+  k_work_submit(&mGattCacheStoreWork.work);
+}
+
+void BleDevice::GattCacheStoreWorkEntry(struct k_work *work) {
+  auto *storeWork = CONTAINER_OF(work, decltype(mGattCacheStoreWork), work);
+  BleDevice *dev = storeWork->dev;
+
+  char key[32];
+  GattCacheKey(bt_conn_get_dst(dev->mConn), key, sizeof(key));
+  int err = settings_save_one(key, &dev->mGattCache,
+                              offsetof(GattCache, records) +
+                                  dev->mGattCache.count * sizeof(GattCacheRecord));
+  LOG_INF("Stored GATT cache with %d handles for %s (err %d)", dev->mGattCache.count, key, err);
+}
+
+void BleDevice::SubscriptionHandler(Subscription *sub, const void *data, uint16_t length) {
+  // data is NULL once the subscription is removed
+  if (data && sub->cb) {
+    BRIDGE_TRACE(NOTIFICATION, sub->params.value_handle, length, 0);
+    sub->cb(sub->ctx, sub->params.value_handle, data, length);
   }
 }
 
@@ -189,20 +507,35 @@ bool BleDevice::CheckSubscriptionParameters(bt_gatt_subscribe_params *params) {
 }
 
 // https://lists.zephyrproject.org/g/devel/topic/ble_services_not_cleared/25177224
-void BleDevice::Subscribe(void *ctx, SubscriptionCallback cb, bt_uuid *charUuid) {
+uint16_t BleDevice::Subscribe(void *ctx, SubscriptionCallback cb, const struct bt_uuid *charUuid) {
   char str[BT_UUID_STR_LEN];
   bt_uuid_to_str(charUuid, str, sizeof(str));
   LOG_INF("Subscribe uuid %s for ctx %p", str, ctx);
 
-  VerifyOrReturn(mConn, LOG_ERR("Invalid connection object"));
+  VerifyOrReturnValue(mConn, 0, LOG_ERR("Invalid connection object"));
+
+  Subscription *sub = nullptr;
+  for (uint8_t i = 0; i < kMaxSubscriptions; i++) {
+    if (!mSubscriptions[i].cb) {
+      sub = &mSubscriptions[i];
+      break;
+    }
+  }
+  VerifyOrReturnValue(sub, 0, LOG_ERR("No free subscription slot"));
 
-  auto *params = chip::Platform::New<bt_gatt_subscribe_params>();
+  bt_gatt_subscribe_params *params = &sub->params;
+  *params = {};
   params->value_handle = findHandleByUuid(charUuid);
   params->ccc_handle = findNextCccdHandleByUuid(params->value_handle);
   params->value = BT_GATT_CCC_NOTIFY;
   params->notify = SubscriptionHandlerEntry;
+  // The parameters are owned by this connection. The stack must not keep them for bonded peers
+  // after a disconnect, the subscription is renewed on reconnect.
+  atomic_set_bit(params->flags, BT_GATT_SUBSCRIBE_FLAG_VOLATILE);
 
-  mSubCbs[params] = std::pair<void *, SubscriptionCallback>(ctx, cb);
+  sub->dev = this;
+  sub->ctx = ctx;
+  sub->cb = cb;
 
   if (CheckSubscriptionParameters(params)) {
     int err = bt_gatt_subscribe(mConn, params);
@@ -211,78 +544,606 @@ void BleDevice::Subscribe(void *ctx, SubscriptionCallback cb, bt_uuid *charUuid)
       Disconnect();      
     } else {
       LOG_INF("Subscribe OK");
+      return params->value_handle;
     }
   } else {
     LOG_ERR("Subscription parameter verification failed. value_handle=%d,  ccc_handle=%d. Disconnect.",
             params->value_handle, params->ccc_handle);
     Disconnect();      
   }
+
+  sub->cb = nullptr;
+  return 0;
 }
 
-void BleDevice::Unsubscribe(struct bt_uuid *charUuid) {
+void BleDevice::Unsubscribe(const struct bt_uuid *charUuid) {
   char str[BT_UUID_STR_LEN];
   bt_uuid_to_str(charUuid, str, sizeof(str));
   LOG_INF("Unsubscribe uuid %s", str);
   VerifyOrReturn(mConn, LOG_ERR("Invalid connection object"));
 
-  for (const auto &[key, value] : mSubCbs) {
-    if (key->value_handle == findHandleByUuid(charUuid)) {
-      int err = bt_gatt_unsubscribe(mConn, key);
+  uint16_t valueHandle = findHandleByUuid(charUuid);
+  for (uint8_t i = 0; i < kMaxSubscriptions; i++) {
+    if (mSubscriptions[i].cb && mSubscriptions[i].params.value_handle == valueHandle) {
+      int err = bt_gatt_unsubscribe(mConn, &mSubscriptions[i].params);
       if (err) {
         LOG_INF("Cannot unsubscribe from posture characteristic (error %d)", err);
       }
-      chip::Platform::Delete(key);
+      mSubscriptions[i].cb = nullptr;
       return;
     }
   }
 }
 
-void BleDevice::GATTReadCallback(bt_conn *conn, uint8_t att_err, bt_gatt_read_params *params,
-                                 const void *data, uint16_t read_len) {
-  LOG_INF("GATT read handler for handle %d (size %d, result %d): ", params->single.handle, read_len,
-          att_err);
-  LOG_HEXDUMP_INF(data, read_len, "  ... data ");
+/****************************
+ * Asynchronous read
+ ****************************/
+int BleDevice::ReadAsync(const struct bt_uuid *uuid, void *ctx, ReadCallback cb) {
+  VerifyOrReturnValue(mConn && cb, -EINVAL, LOG_ERR("Invalid connection object or callback"));
+  uint16_t handle = findHandleByUuid(uuid);
+  if (!handle) {
+    char str[BT_UUID_STR_LEN];
+    bt_uuid_to_str(uuid, str, sizeof(str));
+    LOG_ERR("No handle for uuid %s", str);
+    return -ENOENT;
+  }
+  BRIDGE_TRACE(GATT_READ, handle, 0, 0);
+
+  k_spinlock_key_t key = k_spin_lock(&mReadLock);
+  PendingRead *read = nullptr;
+  for (uint8_t i = 0; i < kMaxPendingReads; i++) {
+    if (mPendingReads[i].state == PendingRead::FREE) {
+      read = &mPendingReads[i];
+      read->state = PendingRead::PENDING;
+      break;
+    }
+  }
+  k_spin_unlock(&mReadLock, key);
+  VerifyOrReturnValue(read, -EBUSY, LOG_WRN("Too many pending reads"));
+
+  read->params = {};
+  read->params.func = PendingReadHandlerEntry;
+  read->params.handle_count = 1;
+  read->params.single.handle = handle;
+  read->params.single.offset = 0;
+  read->dev = this;
+  read->uuid = uuid;
+  read->ctx = ctx;
+  read->cb = cb;
+  read->deadline = k_uptime_get() + kReadTimeoutMs;
 
-  if (!att_err && (read_len <= mGattReadBufferSize)) {
-    memcpy(mGattReadBuffer, data, read_len);
-    mGattReadSize = read_len;
-  } else {
-    LOG_ERR("Unsuccessful GATT read operation (err %d)", att_err);
+  int err = bt_gatt_read(mConn, &read->params);
+  if (err) {
+    LOG_ERR("GATT read failed (err %d)", err);
+    read->state = PendingRead::FREE;
+    return err;
   }
-  k_poll_signal_raise(&mGattReadSignal, 1);
+
+  // Already scheduled for an earlier read otherwise.
+  k_work_schedule(&mReadTimeoutWork.work, K_MSEC(kReadTimeoutMs));
+  return 0;
 }
 
-bool BleDevice::Read(struct bt_uuid *uuid, uint8_t *buffer, uint16_t maxReadLength) {
-  char str[BT_UUID_STR_LEN];
-  bt_uuid_to_str(uuid, str, sizeof(str));
-  LOG_INF("Read uuid %s to buffer %p with max length %d", str, (void *)buffer, maxReadLength);
+void BleDevice::PendingReadHandler(PendingRead *read, uint8_t att_err, const void *data,
+                                   uint16_t length) {
+  k_spinlock_key_t key = k_spin_lock(&mReadLock);
+  bool pending = read->state == PendingRead::PENDING;
+  PendingRead request = *read;
+  read->state = PendingRead::FREE;
+  k_spin_unlock(&mReadLock, key);
 
-  bt_gatt_read_params params;
-  params.func = GATTReadCallbackEntry;
-  params.handle_count = 1;
-  params.single.handle = findHandleByUuid(uuid);
-  params.single.offset = 0;
+  // The requester already got a timeout.
+  VerifyOrReturn(pending);
 
-  int err = bt_gatt_read(mConn, &params);
-  if (err) {
-    LOG_INF("GATT read failed (err %d)", err);
+  if (att_err) {
+    LOG_ERR("GATT read of handle %d failed (err %d)", request.params.single.handle, att_err);
+  }
+  request.cb(request.ctx, request.uuid, att_err ? -EIO : 0,
+             reinterpret_cast<const uint8_t *>(data), att_err ? 0 : length);
+}
+
+void BleDevice::ReadTimeoutWorkEntry(struct k_work *work) {
+  auto *timeoutWork =
+      CONTAINER_OF(k_work_delayable_from_work(work), decltype(mReadTimeoutWork), work);
+  timeoutWork->dev->ExpirePendingReads();
+}
+
+void BleDevice::ExpirePendingReads() {
+  PendingRead expired[kMaxPendingReads];
+  uint8_t expiredCount = 0;
+  int64_t now = k_uptime_get();
+  int64_t nextDeadline = INT64_MAX;
+
+  k_spinlock_key_t key = k_spin_lock(&mReadLock);
+  for (uint8_t i = 0; i < kMaxPendingReads; i++) {
+    if (mPendingReads[i].state != PendingRead::PENDING) {
+      continue;
+    }
+    if (mPendingReads[i].deadline <= now) {
+      mPendingReads[i].state = PendingRead::ABANDONED;
+      expired[expiredCount++] = mPendingReads[i];
+    } else {
+      nextDeadline = MIN(nextDeadline, mPendingReads[i].deadline);
+    }
   }
+  k_spin_unlock(&mReadLock, key);
 
-  k_poll_signal_init(&mGattReadSignal);
-  k_poll_event_init(mGattWaitEvents, K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY, &mGattReadSignal);
-  k_poll(mGattWaitEvents, ARRAY_SIZE(mGattWaitEvents), K_SECONDS(3));
-  k_poll_signal_reset(&mGattReadSignal);
+  if (nextDeadline != INT64_MAX) {
+    k_work_schedule(&mReadTimeoutWork.work, K_MSEC(nextDeadline - now));
+  }
 
-  bool gattReadSuccess = mGattReadSize > 0;
-  if (gattReadSuccess && mGattReadSize <= maxReadLength) {
-    *buffer = *mGattReadBuffer;
+  for (uint8_t i = 0; i < expiredCount; i++) {
+    LOG_ERR("GATT read of handle %d timed out", expired[i].params.single.handle);
+    expired[i].cb(expired[i].ctx, expired[i].uuid, -ETIMEDOUT, nullptr, 0);
   }
+}
+
+void BleDevice::CancelPendingReads() {
+  k_work_cancel_delayable_sync(&mReadTimeoutWork.work, &mReadTimeoutSync);
 
-  mGattReadSize = 0;
+  for (uint8_t i = 0; i < kMaxPendingReads; i++) {
+    if (mPendingReads[i].state == PendingRead::PENDING) {
+      mPendingReads[i].state = PendingRead::FREE;
+      mPendingReads[i].cb(mPendingReads[i].ctx, mPendingReads[i].uuid, -ECONNRESET, nullptr, 0);
+    }
+  }
+}
+
+bool BleDevice::Read(const struct bt_uuid *uuid, uint8_t *buffer, uint16_t maxReadLength,
+                     uint16_t *readLength) {
+  struct SyncRead {
+    struct k_poll_signal signal;
+    uint8_t *buffer;
+    uint16_t maxLength;
+    uint16_t length;
+  } sync = {{}, buffer, maxReadLength, 0};
+
+  k_poll_signal_init(&sync.signal);
+  int err = ReadAsync(uuid, &sync,
+                      [](void *ctx, const struct bt_uuid *uuid, int err, const uint8_t *data,
+                         uint16_t length) {
+                        auto *sync = reinterpret_cast<SyncRead *>(ctx);
+                        if (!err && length > 0 && length <= sync->maxLength) {
+                          memcpy(sync->buffer, data, length);
+                          sync->length = length;
+                        }
+                        k_poll_signal_raise(&sync->signal, err);
+                      });
+  VerifyOrReturnValue(err == 0, false);
+
+  // ReadAsync calls back in any case, at the latest after kReadTimeoutMs.
+  struct k_poll_event event =
+      K_POLL_EVENT_INITIALIZER(K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY, &sync.signal);
+  k_poll(&event, 1, K_FOREVER);
+
+  bool gattReadSuccess = sync.length > 0;
+  if (gattReadSuccess && readLength) {
+    *readLength = sync.length;
+  }
   LOG_INF("Read success %s", gattReadSuccess ? "true" : "false");
   return gattReadSuccess;
 }
 
+/****************************
+ * Batched read
+ ****************************/
+int BleDevice::ReadMultipleAsync(const struct bt_uuid *const *uuids, uint8_t count, void *ctx,
+                                 BatchReadCallback cb) {
+  VerifyOrReturnValue(mConn && uuids && cb && count > 0 && count <= kMaxBatchReads, -EINVAL,
+                      LOG_ERR("Invalid batch read of %d values", count));
+
+  k_spinlock_key_t key = k_spin_lock(&mBatchLock);
+  // Single reads of a batch that timed out may still be owned by the stack.
+  if (mBatchState != BatchState::IDLE || atomic_get(&mBatchPending) != 0) {
+    k_spin_unlock(&mBatchLock, key);
+    LOG_ERR("Previous batch read still pending");
+    return -EBUSY;
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    mBatchRequests[i] = {uuids[i], mBatchBuffers[i], GATT_READ_BUF_SIZE, 0};
+    mBatchHandles[i] = findHandleByUuid(uuids[i]);
+  }
+  mBatchCount = count;
+  mBatchCtx = ctx;
+  mBatchCb = cb;
+  mBatchStartMs = k_uptime_get();
+  mBatchState = BatchState::READ_MULTIPLE;
+  k_spin_unlock(&mBatchLock, key);
+
+  if (count == 1 || !mReadMultipleSupported || !ReadMultipleVariable()) {
+    ReadPipelined();
+  }
+  return 0;
+}
+
+bool BleDevice::ReadMultipleVariable() {
+#if defined(CONFIG_BT_GATT_READ_MULT_VAR_LEN)
+  k_spinlock_key_t key = k_spin_lock(&mBatchLock);
+  bool inFlight = mReadMultipleInFlight;
+  mReadMultipleInFlight = true;
+  mReadMultipleAbandoned = false;
+  k_spin_unlock(&mBatchLock, key);
+  if (inFlight) {
+    LOG_INF("Previous read multiple still in flight");
+    return false;
+  }
+
+  bt_gatt_read_params &params = mReadMultipleParams;
+  params = {};
+  params.func = ReadMultipleCallbackEntry;
+  params.handle_count = mBatchCount;
+  params.multiple.handles = mBatchHandles;
+  params.multiple.variable = true;
+
+  mBatchNext = 0;
+  mBatchAttError = 0;
+  atomic_set(&mBatchPending, 1);
+  ScheduleBatchTimeout();
+  int err = bt_gatt_read(mConn, &params);
+  if (err) {
+    LOG_INF("Read multiple failed (err %d)", err);
+    atomic_set(&mBatchPending, 0);
+    key = k_spin_lock(&mBatchLock);
+    mReadMultipleInFlight = false;
+    k_spin_unlock(&mBatchLock, key);
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+uint8_t BleDevice::ReadMultipleCallback(uint8_t att_err, const void *data, uint16_t read_len) {
+  k_spinlock_key_t key = k_spin_lock(&mBatchLock);
+  // The requests of an abandoned read belong to the single reads that replaced it.
+  bool abandoned = mReadMultipleAbandoned;
+  if (att_err && !abandoned) {
+    mBatchAttError = att_err;
+  } else if (data && !abandoned && mBatchNext < mBatchCount) {
+    // Values arrive one by one in the order of the requested handles.
+    ReadRequest &request = mBatchRequests[mBatchNext];
+    if (read_len <= request.maxLength) {
+      memcpy(request.buffer, data, read_len);
+      request.length = read_len;
+    }
+  }
+  mBatchNext++;
+  // Called a last time without data once the response is processed.
+  bool last = att_err || !data;
+  if (last) {
+    mReadMultipleInFlight = false;
+    mReadMultipleAbandoned = false;
+  }
+  k_spin_unlock(&mBatchLock, key);
+
+  if (last) {
+    if (!abandoned) {
+      CompleteBatchRead();
+    }
+    return BT_GATT_ITER_STOP;
+  }
+  return BT_GATT_ITER_CONTINUE;
+}
+
+void BleDevice::ReadPipelined() {
+  k_spinlock_key_t key = k_spin_lock(&mBatchLock);
+  mBatchState = BatchState::SINGLE_READS;
+  uint8_t count = mBatchCount;
+  k_spin_unlock(&mBatchLock, key);
+
+  // The ATT layer queues the requests, they go out without waiting for the application.
+  atomic_set(&mBatchPending, count);
+  ScheduleBatchTimeout();
+  for (uint8_t i = 0; i < count; i++) {
+    bt_gatt_read_params &params = mBatchReadParams[i];
+    params = {};
+    params.func = BatchReadCallbackEntry;
+    params.handle_count = 1;
+    params.single.handle = mBatchHandles[i];
+    params.single.offset = 0;
+
+    int err = mBatchHandles[i] ? bt_gatt_read(mConn, &params) : -ENOENT;
+    if (err) {
+      LOG_INF("GATT read of handle %d failed (err %d)", mBatchHandles[i], err);
+      CompleteBatchRead();
+    }
+  }
+}
+
+void BleDevice::BatchReadCallback(bt_gatt_read_params *params, uint8_t att_err, const void *data,
+                                  uint16_t read_len) {
+  uint8_t index = params - mBatchReadParams;
+
+  k_spinlock_key_t key = k_spin_lock(&mBatchLock);
+  // Values arriving after the batch timed out are dropped.
+  if (!att_err && data && mBatchState == BatchState::SINGLE_READS && index < mBatchCount) {
+    ReadRequest &request = mBatchRequests[index];
+    if (read_len <= request.maxLength) {
+      memcpy(request.buffer, data, read_len);
+      request.length = read_len;
+    }
+  } else if (att_err) {
+    LOG_ERR("GATT read of handle %d failed (err %d)", params->single.handle, att_err);
+  }
+  k_spin_unlock(&mBatchLock, key);
+
+  CompleteBatchRead();
+}
+
+void BleDevice::CompleteBatchRead() {
+  if (atomic_dec(&mBatchPending) != 1) {
+    return;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&mBatchLock);
+  BatchState state = mBatchState;
+  k_spin_unlock(&mBatchLock, key);
+
+  if (state == BatchState::READ_MULTIPLE) {
+    if (mBatchAttError == BT_ATT_ERR_NOT_SUPPORTED) {
+      LOG_INF("Peer does not support read multiple variable length");
+      mReadMultipleSupported = false;
+    }
+    // Other errors concern single values, e.g. insufficient authentication. Single reads tell
+    // which.
+    if (mBatchAttError) {
+      ReadPipelined();
+      return;
+    }
+  }
+  FinishBatchRead();
+}
+
+void BleDevice::FinishBatchRead() {
+  k_spinlock_key_t key = k_spin_lock(&mBatchLock);
+  BatchState state = mBatchState;
+  mBatchState = BatchState::IDLE;
+  void *ctx = mBatchCtx;
+  BatchReadCallback cb = mBatchCb;
+  k_spin_unlock(&mBatchLock, key);
+  // Finished by the last response and the timeout at the same time.
+  VerifyOrReturn(state != BatchState::IDLE);
+
+  uint8_t read = 0;
+  for (uint8_t i = 0; i < mBatchCount; i++) {
+    read += mBatchRequests[i].length > 0;
+  }
+  LOG_INF("Read %d of %d values in %lld ms (%s)", read, mBatchCount,
+          k_uptime_get() - mBatchStartMs,
+          state == BatchState::READ_MULTIPLE ? "read multiple" : "single reads");
+  cb(ctx, mBatchRequests, mBatchCount);
+}
+
+void BleDevice::ScheduleBatchTimeout() {
+  k_spinlock_key_t key = k_spin_lock(&mBatchLock);
+  mBatchDeadline = k_uptime_get() + kReadTimeoutMs;
+  k_spin_unlock(&mBatchLock, key);
+  k_work_reschedule(&mBatchTimeoutWork.work, K_MSEC(kReadTimeoutMs));
+}
+
+void BleDevice::BatchTimeoutWorkEntry(struct k_work *work) {
+  auto *timeoutWork =
+      CONTAINER_OF(k_work_delayable_from_work(work), decltype(mBatchTimeoutWork), work);
+  timeoutWork->dev->ExpireBatchRead();
+}
+
+void BleDevice::ExpireBatchRead() {
+  k_spinlock_key_t key = k_spin_lock(&mBatchLock);
+  BatchState state = mBatchState;
+  // A timeout of the previous phase that was already running when the next one rescheduled it.
+  bool expired = state != BatchState::IDLE && k_uptime_get() >= mBatchDeadline;
+  if (expired && state == BatchState::READ_MULTIPLE) {
+    // Unless the response arrived just now, give up on it and let the single reads take over.
+    mReadMultipleAbandoned = mReadMultipleInFlight;
+    expired = mReadMultipleAbandoned;
+  }
+  k_spin_unlock(&mBatchLock, key);
+  VerifyOrReturn(expired);
+
+  LOG_ERR("Batch read timed out");
+  if (state == BatchState::READ_MULTIPLE) {
+    atomic_set(&mBatchPending, 0);
+    ReadPipelined();
+  } else {
+    // The stack keeps the parameters of the outstanding reads, mBatchPending stays set until
+    // they are handed back.
+    FinishBatchRead();
+  }
+}
+
+void BleDevice::CancelBatchRead() {
+  k_work_cancel_delayable_sync(&mBatchTimeoutWork.work, &mBatchTimeoutSync);
+  FinishBatchRead();
+}
+
 void BleDevice::Disconnect() {
   bt_conn_disconnect(mConn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
 }
+
+/****************************
+ * Writes
+ ****************************/
+static BleDevice::WriteStats sWriteStats;
+static struct k_spinlock sWriteStatsLock;
+
+BleDevice::WriteStats BleDevice::GetWriteStats() {
+  k_spinlock_key_t key = k_spin_lock(&sWriteStatsLock);
+  WriteStats stats = sWriteStats;
+  k_spin_unlock(&sWriteStatsLock, key);
+  return stats;
+}
+
+int BleDevice::WriteAsync(const struct bt_uuid *uuid, const uint8_t *data, uint16_t length,
+                          void *ctx, WriteCallback cb) {
+  VerifyOrReturnValue(mConn && data && cb, -EINVAL, LOG_ERR("Invalid connection object or data"));
+  VerifyOrReturnValue(length > 0 && length <= kMaxWriteLength, -EMSGSIZE,
+                      LOG_ERR("Cannot write %d bytes", length));
+  uint16_t handle = findHandleByUuid(uuid);
+  int idx = handle ? FindEntry(handle) : -1;
+  VerifyOrReturnValue(idx >= 0, -ENOENT, LOG_ERR("No handle to write"));
+  uint8_t properties = mHandles[idx].properties;
+  bool withoutResponse = properties & BT_GATT_CHRC_WRITE_WITHOUT_RESP;
+  VerifyOrReturnValue(withoutResponse || (properties & BT_GATT_CHRC_WRITE), -EPERM,
+                      LOG_ERR("Handle %d is not writable", handle));
+  BRIDGE_TRACE(GATT_WRITE, handle, length, withoutResponse);
+
+  k_spinlock_key_t key = k_spin_lock(&mWriteLock);
+  PendingWrite *write = nullptr;
+  PendingWrite replaced = {};
+  bool coalesced = false;
+  for (uint8_t i = 0; i < kMaxPendingWrites; i++) {
+    if (mPendingWrites[i].state == PendingWrite::QUEUED && mPendingWrites[i].handle == handle) {
+      write = &mPendingWrites[i];
+      replaced = *write;
+      coalesced = true;
+      break;
+    }
+  }
+  for (uint8_t i = 0; i < kMaxPendingWrites && !write; i++) {
+    if (mPendingWrites[i].state == PendingWrite::FREE) {
+      write = &mPendingWrites[i];
+      write->state = PendingWrite::QUEUED;
+      write->dev = this;
+      write->uuid = uuid;
+      write->handle = handle;
+      write->withoutResponse = withoutResponse;
+      write->queuedCyc = k_cycle_get_32();
+    }
+  }
+  if (write) {
+    memcpy(write->data, data, length);
+    write->length = length;
+    write->ctx = ctx;
+    write->cb = cb;
+  }
+  k_spin_unlock(&mWriteLock, key);
+  VerifyOrReturnValue(write, -EBUSY, LOG_WRN("Too many pending writes"));
+
+  key = k_spin_lock(&sWriteStatsLock);
+  sWriteStats.queued++;
+  sWriteStats.coalesced += coalesced;
+  k_spin_unlock(&sWriteStatsLock, key);
+
+  if (coalesced) {
+    replaced.cb(replaced.ctx, replaced.uuid, -ECANCELED, replaced.queuedCyc);
+  }
+
+  // Already scheduled if other writes are waiting.
+  k_work_schedule(&mWriteWork.work, K_MSEC(kWriteCoalesceWindowMs));
+  return 0;
+}
+
+void BleDevice::WriteWorkEntry(struct k_work *work) {
+  auto *writeWork = CONTAINER_OF(k_work_delayable_from_work(work), decltype(mWriteWork), work);
+  writeWork->dev->SendWrites();
+}
+
+void BleDevice::SendWrites() {
+  while (true) {
+    PendingWrite *write = nullptr;
+    k_spinlock_key_t key = k_spin_lock(&mWriteLock);
+    for (uint8_t i = 0; i < kMaxPendingWrites; i++) {
+      PendingWrite &pending = mPendingWrites[i];
+      if (pending.state != PendingWrite::QUEUED ||
+          (pending.withoutResponse ? mWriteCredits == 0 : mWriteRequestPending)) {
+        continue;
+      }
+      write = &pending;
+      write->state = PendingWrite::IN_FLIGHT;
+      if (write->withoutResponse) {
+        mWriteCredits--;
+      } else {
+        mWriteRequestPending = true;
+      }
+      break;
+    }
+    k_spin_unlock(&mWriteLock, key);
+    // Nothing queued, or waiting for credits. CompleteWrite continues.
+    VerifyOrReturn(write);
+
+    int err;
+    if (write->withoutResponse) {
+      err = bt_gatt_write_without_response_cb(mConn, write->handle, write->data, write->length,
+                                              false, WriteSentEntry, write);
+    } else {
+      write->params = {};
+      write->params.func = WriteResponseEntry;
+      write->params.handle = write->handle;
+      write->params.data = write->data;
+      write->params.length = write->length;
+      err = bt_gatt_write(mConn, &write->params);
+    }
+
+    if (err == -ENOMEM || err == -ENOBUFS) {
+      // Out of TX buffers, the write stays queued.
+      key = k_spin_lock(&mWriteLock);
+      write->state = PendingWrite::QUEUED;
+      if (write->withoutResponse) {
+        mWriteCredits++;
+      } else {
+        mWriteRequestPending = false;
+      }
+      k_spin_unlock(&mWriteLock, key);
+      k_work_reschedule(&mWriteWork.work, K_MSEC(kWriteRetryMs));
+      return;
+    }
+    if (err) {
+      CompleteWrite(write, err);
+    }
+  }
+}
+
+void BleDevice::CompleteWrite(PendingWrite *write, int err) {
+  k_spinlock_key_t key = k_spin_lock(&mWriteLock);
+  bool inFlight = write->state == PendingWrite::IN_FLIGHT;
+  PendingWrite done = *write;
+  if (inFlight) {
+    write->state = PendingWrite::FREE;
+    if (write->withoutResponse) {
+      mWriteCredits++;
+    } else {
+      mWriteRequestPending = false;
+    }
+  }
+  bool queued = false;
+  for (uint8_t i = 0; i < kMaxPendingWrites; i++) {
+    queued |= mPendingWrites[i].state == PendingWrite::QUEUED;
+  }
+  k_spin_unlock(&mWriteLock, key);
+
+  // Cancelled with the connection already.
+  VerifyOrReturn(inFlight);
+
+  key = k_spin_lock(&sWriteStatsLock);
+  if (err) {
+    sWriteStats.failed++;
+  } else if (done.withoutResponse) {
+    sWriteStats.withoutResponse++;
+  } else {
+    sWriteStats.withResponse++;
+  }
+  k_spin_unlock(&sWriteStatsLock, key);
+
+  if (err) {
+    LOG_ERR("GATT write of handle %d failed (err %d)", done.handle, err);
+  }
+  done.cb(done.ctx, done.uuid, err, done.queuedCyc);
+
+  // A credit or the request slot is free again, the waiting writes already had their window.
+  if (queued) {
+    k_work_reschedule(&mWriteWork.work, K_NO_WAIT);
+  }
+}
+
+void BleDevice::CancelPendingWrites() {
+  k_work_cancel_delayable_sync(&mWriteWork.work, &mWriteSync);
+
+  for (uint8_t i = 0; i < kMaxPendingWrites; i++) {
+    if (mPendingWrites[i].state != PendingWrite::FREE) {
+      mPendingWrites[i].state = PendingWrite::FREE;
+      mPendingWrites[i].cb(mPendingWrites[i].ctx, mPendingWrites[i].uuid, -ECONNRESET,
+                           mPendingWrites[i].queuedCyc);
+    }
+  }
+}
@@ -11,62 +11,193 @@
 #include <map>
 #include <utility>
 
+#include "ble_matter_profile.h"
+
 #define GATT_READ_BUF_SIZE 24
+#define GATT_DB_HASH_SIZE 16
 
 // Cyclic dependencies -> Forward declaration.
 class MatterDevice;
 
 class BleDevice {
  public:
+  static constexpr uint8_t kMaxAttributes = CONFIG_BRIDGE_BLE_MAX_ATTRS;
+  static constexpr uint8_t kMaxSubscriptions = 4;
+  static constexpr uint8_t kMaxBatchReads = 8;
+  static constexpr uint8_t kMaxPendingReads = 4;
+  static constexpr uint32_t kReadTimeoutMs = 3000;
+  static constexpr uint8_t kMaxPendingWrites = 4;
+  // Longest value written in one packet with the default ATT MTU.
+  static constexpr uint8_t kMaxWriteLength = 20;
+  static constexpr uint32_t kWriteCoalesceWindowMs = CONFIG_BRIDGE_BLE_WRITE_COALESCE_MS;
+  static constexpr uint8_t kWriteCredits = CONFIG_BRIDGE_BLE_WRITE_CREDITS;
+  // Delay before a write that found no TX buffer is tried again.
+  static constexpr uint32_t kWriteRetryMs = 20;
+
   using DiscoveryCallback = void (*)(void *ctx);
-  using SubscriptionCallback = void (*)(void *ctx, struct bt_uuid *charUuid, const void *data,
+  using SubscriptionCallback = void (*)(void *ctx, uint16_t valueHandle, const void *data,
                                         uint16_t length);
+  // err is 0 on success, -EIO on an ATT error, -ETIMEDOUT or -ECONNRESET.
+  using ReadCallback = void (*)(void *ctx, const struct bt_uuid *uuid, int err, const uint8_t *data,
+                                uint16_t length);
+  // err is 0 once a write request was acknowledged or a write without response was sent,
+  // -ECANCELED if a newer value replaced it before it went out.
+  // queuedCyc is the k_cycle_get_32 time the write, or the first one it was coalesced with, was
+  // queued.
+  using WriteCallback = void (*)(void *ctx, const struct bt_uuid *uuid, int err,
+                                 uint32_t queuedCyc);
 
   struct DiscoveryContext {
     void *dev;
     DiscoveryCallback cb;
   };
 
+  // One characteristic value of a batched read. length is 0 if the value could not be read.
+  struct ReadRequest {
+    const struct bt_uuid *uuid;
+    uint8_t *buffer;
+    uint16_t maxLength;
+    uint16_t length;
+  };
+
+  // requests are in the order of the uuids and valid until the callback returns.
+  using BatchReadCallback = void (*)(void *ctx, const ReadRequest *requests, uint8_t count);
+
+  // Handle map of a bonded peer as stored in settings, valid as long as the peer's Database Hash
+  // does not change.
+  struct GattCacheRecord {
+    uint16_t handle;
+    uint8_t properties;
+    uint8_t uuidLength;
+    uint8_t uuid[BT_UUID_SIZE_128];
+  } __packed;
+
+  struct GattCache {
+    uint8_t hash[GATT_DB_HASH_SIZE];
+    uint8_t count;
+    GattCacheRecord records[CONFIG_BRIDGE_BLE_MAX_ATTRS];
+  } __packed;
+
+  // Writes of all connections since boot.
+  struct WriteStats {
+    uint32_t queued;
+    uint32_t coalesced;
+    uint32_t withoutResponse;
+    uint32_t withResponse;
+    uint32_t failed;
+  };
+
   BleDevice(bt_conn *conn) {
     mConn = conn;
     bt_conn_ref(mConn);
     addInstance(mConn, this);
+    mGattCacheStoreWork.dev = this;
+    k_work_init(&mGattCacheStoreWork.work, GattCacheStoreWorkEntry);
+    mReadTimeoutWork.dev = this;
+    k_work_init_delayable(&mReadTimeoutWork.work, ReadTimeoutWorkEntry);
+    mBatchTimeoutWork.dev = this;
+    k_work_init_delayable(&mBatchTimeoutWork.work, BatchTimeoutWorkEntry);
+    mWriteWork.dev = this;
+    k_work_init_delayable(&mWriteWork.work, WriteWorkEntry);
   }
   ~BleDevice() {
     printk("~BleDevice");
+    k_work_cancel_sync(&mGattCacheStoreWork.work, &mGattCacheStoreSync);
+    CancelBatchRead();
+    CancelPendingReads();
+    CancelPendingWrites();
     bt_conn_unref(mConn);
     printk("bt_conn_unref OK");
-
-    for (const auto &[key, value] : mHandleToUuid) {
-      if (value) {
-        printk("Delete value");
-        chip::Platform::Delete(value);
-      }
-    }
-
-    for (const auto &[key, value] : mSubCbs) {
-      if (key) {
-        printk("Delete key");
-        chip::Platform::Delete(key);
-      }
-    }
+    removeInstance(mConn);
   }
 
   static std::map<bt_conn *, BleDevice *> instances;
   static BleDevice *Instance(bt_conn *conn) { return instances[conn]; }
+  // Removes the GATT handles cached for a bonded peer.
+  static void DeleteGattCache(const bt_addr_le_t *peer);
 
-  void Discover(void *ctx, DiscoveryCallback cb, struct bt_uuid *serviceUuid);
-  void Unsubscribe(struct bt_uuid *charUuid);
-  void Subscribe(void *ctx, SubscriptionCallback cb, bt_uuid *charUuid);
-  bool Read(struct bt_uuid *uuid, uint8_t *buffer, uint16_t maxReadLength);
+  // Link settings of the peripheral, nullptr keeps the ones the connection was created with. Set
+  // before Discover: discovery runs on the profile's discovery parameters, the idle ones are
+  // requested by ApplyIdleLinkProfile once the owner has set the device up.
+  void SetLinkProfile(const BleMatterProfile::LinkProfile *link) { mLink = link; }
+  void ApplyIdleLinkProfile();
+  void Discover(void *ctx, DiscoveryCallback cb, const struct bt_uuid *serviceUuid);
+  void Unsubscribe(const struct bt_uuid *charUuid);
+  // Returns the value handle notifications will be reported with, 0 on failure.
+  uint16_t Subscribe(void *ctx, SubscriptionCallback cb, const struct bt_uuid *charUuid);
+  // Blocking read on top of ReadAsync. Must not be called from the BT RX thread or the system
+  // workqueue, which complete the read.
+  bool Read(const struct bt_uuid *uuid, uint8_t *buffer, uint16_t maxReadLength,
+            uint16_t *readLength = nullptr);
+  // Start reading a characteristic without waiting for the value. cb is called exactly once: from
+  // the BT RX thread with the value or an error, or from the system workqueue once
+  // kReadTimeoutMs passed. Up to kMaxPendingReads reads may be pending, -EBUSY beyond that.
+  int ReadAsync(const struct bt_uuid *uuid, void *ctx, ReadCallback cb);
+  // Start reading several characteristics with one Read Multiple Variable Length request. Falls
+  // back to single reads, all issued at once, if the peer does not support it or does not answer
+  // within kReadTimeoutMs. cb is called exactly once, from the BT RX thread or the system
+  // workqueue, unless an error is returned. One batch at a time, -EBUSY otherwise.
+  int ReadMultipleAsync(const struct bt_uuid *const *uuids, uint8_t count, void *ctx,
+                        BatchReadCallback cb);
+  // Queue a write of a characteristic value, cb is called exactly once unless an error is returned.
+  // Writes are coalesced: a value still queued for the same characteristic is replaced by the new
+  // one, the replaced write is completed with -ECANCELED right away. Writes go out
+  // kWriteCoalesceWindowMs after the first one was queued. Characteristics supporting it are
+  // written without response, at most kWriteCredits packets per connection at a time. Others get
+  // write requests, one at a time.
+  int WriteAsync(const struct bt_uuid *uuid, const uint8_t *data, uint16_t length, void *ctx,
+                 WriteCallback cb);
+  static WriteStats GetWriteStats();
 
   void DiscoveryNotFound(bt_conn *conn, void *context);
   void DiscoveryError(bt_conn *conn, int err, void *context);
   void DiscoveryCompletedHandler(bt_gatt_dm *dm, void *context);
-  void SubscriptionHandler(bt_conn *conn, bt_gatt_subscribe_params *params, const void *data,
-                           uint16_t length);
-  void GATTReadCallback(bt_conn *conn, uint8_t att_err, bt_gatt_read_params *params,
-                        const void *data, uint16_t read_len);
+  // Subscription parameters together with their receiver. The notify callback gets back to this
+  // struct from the parameters, without any lookup.
+  struct Subscription {
+    bt_gatt_subscribe_params params;
+    BleDevice *dev;
+    void *ctx;
+    SubscriptionCallback cb;
+  };
+
+  void SubscriptionHandler(Subscription *sub, const void *data, uint16_t length);
+
+  // Read parameters together with their requester. A read that timed out is abandoned, its slot
+  // stays in use until the stack hands back the parameters.
+  struct PendingRead {
+    enum { FREE, PENDING, ABANDONED } state;
+    bt_gatt_read_params params;
+    BleDevice *dev;
+    const struct bt_uuid *uuid;
+    void *ctx;
+    ReadCallback cb;
+    int64_t deadline;
+  };
+
+  void PendingReadHandler(PendingRead *read, uint8_t att_err, const void *data, uint16_t length);
+
+  // A queued write replaces its value until it is IN_FLIGHT, from then on the stack owns data.
+  struct PendingWrite {
+    enum { FREE, QUEUED, IN_FLIGHT } state;
+    bt_gatt_write_params params;
+    BleDevice *dev;
+    const struct bt_uuid *uuid;
+    uint16_t handle;
+    bool withoutResponse;
+    uint8_t data[kMaxWriteLength];
+    uint16_t length;
+    void *ctx;
+    WriteCallback cb;
+    uint32_t queuedCyc;
+  };
+
+  void CompleteWrite(PendingWrite *write, int err);
+  void DatabaseHashReadCallback(bt_conn *conn, uint8_t att_err, const void *data,
+                                uint16_t read_len);
+  uint8_t ReadMultipleCallback(uint8_t att_err, const void *data, uint16_t read_len);
+  void BatchReadCallback(bt_gatt_read_params *params, uint8_t att_err, const void *data,
+                         uint16_t read_len);
 
   void Disconnect();
 
@@ -76,17 +207,129 @@ class BleDevice {
 
   bool CheckSubscriptionParameters(bt_gatt_subscribe_params *params);
 
-  uint16_t findHandleByUuid(struct bt_uuid *uuid);
+  void StartFullDiscovery();
+  void CompleteDiscovery();
+  void UpdatePhyAndDataLength();
+  void UpdateConnectionParameters(const bt_le_conn_param &param, const char *phase);
+  bool IsBonded();
+  static void GattCacheKey(const bt_addr_le_t *addr, char *key, size_t size);
+  bool LoadGattCache();
+  void RestoreGattCache();
+  void ReadDatabaseHash();
+  static void GattCacheStoreWorkEntry(struct k_work *work);
+
+  bool ReadMultipleVariable();
+  void ReadPipelined();
+  void CompleteBatchRead();
+  void FinishBatchRead();
+  void ScheduleBatchTimeout();
+  static void BatchTimeoutWorkEntry(struct k_work *work);
+  void ExpireBatchRead();
+  void CancelBatchRead();
+
+  static void ReadTimeoutWorkEntry(struct k_work *work);
+  void ExpirePendingReads();
+  void CancelPendingReads();
+
+  static void WriteWorkEntry(struct k_work *work);
+  void SendWrites();
+  void CancelPendingWrites();
+
+  uint16_t findHandleByUuid(const struct bt_uuid *uuid);
   uint16_t findNextCccdHandleByUuid(uint16_t attrHandle);
+  struct bt_uuid *findUuidByHandle(uint16_t handle);
+
+  // Handle table. Entries live inside the BleDevice, so they are released together with the
+  // connection. Discovery delivers attributes in ascending handle order, which keeps the table
+  // sorted by handle. The first handle of each UUID is also reachable through a hashed index.
+  union UuidStorage {
+    struct bt_uuid uuid;
+    struct bt_uuid_16 u16;
+    struct bt_uuid_32 u32;
+    struct bt_uuid_128 u128;
+  };
+  // properties are the characteristic properties on value handles, 0 on all others.
+  struct HandleEntry {
+    uint16_t handle;
+    uint8_t properties;
+    UuidStorage uuid;
+  };
+  static constexpr uint8_t kUuidIndexSize = (kMaxAttributes * 2 <= 32)    ? 32
+                                            : (kMaxAttributes * 2 <= 64)  ? 64
+                                            : (kMaxAttributes * 2 <= 128) ? 128
+                                                                          : 255;
+
+  static uint8_t HashUuid(const struct bt_uuid *uuid);
+  bool AddHandle(uint16_t handle, const struct bt_uuid *uuid, uint8_t properties);
+  int FindEntry(uint16_t handle);
 
   bt_conn *mConn;
-  std::map<uint16_t, struct bt_uuid *> mHandleToUuid;
-  std::map<bt_gatt_subscribe_params *, std::pair<void *, SubscriptionCallback>> mSubCbs;
+  HandleEntry mHandles[kMaxAttributes];
+  uint8_t mHandleCount = 0;
+  // Entry index + 1, 0 marks an empty slot.
+  uint8_t mUuidIndex[kUuidIndexSize] = {};
+  Subscription mSubscriptions[kMaxSubscriptions] = {};
   struct DiscoveryContext mDisCb = {NULL, NULL};
+  const struct bt_uuid *mServiceUuid = nullptr;
+  int64_t mDiscoveryStartMs;
+  const BleMatterProfile::LinkProfile *mLink = nullptr;
+
+  // Discovery cache. While mVerifyingGattCache is set the loaded cache waits for the hash check,
+  // otherwise the hash read after a full discovery is stored together with the new handle map.
+  GattCache mGattCache;
+  bool mVerifyingGattCache = false;
+  bt_gatt_read_params mHashReadParams;
+  struct {
+    struct k_work work;
+    BleDevice *dev;
+  } mGattCacheStoreWork;
+  struct k_work_sync mGattCacheStoreSync;
+
+  PendingRead mPendingReads[kMaxPendingReads] = {};
+  struct k_spinlock mReadLock;
+  struct {
+    struct k_work_delayable work;
+    BleDevice *dev;
+  } mReadTimeoutWork;
+  struct k_work_sync mReadTimeoutSync;
+
+  // Batched read. A batch starts with Read Multiple and moves on to single reads on an error or
+  // timeout, values arriving after the batch finished are dropped.
+  enum class BatchState : uint8_t { IDLE, READ_MULTIPLE, SINGLE_READS };
+  BatchState mBatchState = BatchState::IDLE;
+  bool mReadMultipleSupported = IS_ENABLED(CONFIG_BT_GATT_READ_MULT_VAR_LEN);
+  bt_gatt_read_params mBatchReadParams[kMaxBatchReads];
+  // Own parameters for Read Multiple, the stack keeps them until the response arrived, even after
+  // the batch gave up waiting and fell back to single reads. An abandoned response is dropped.
+  bt_gatt_read_params mReadMultipleParams;
+  bool mReadMultipleInFlight = false;
+  bool mReadMultipleAbandoned = false;
+  uint16_t mBatchHandles[kMaxBatchReads];
+  ReadRequest mBatchRequests[kMaxBatchReads];
+  uint8_t mBatchBuffers[kMaxBatchReads][GATT_READ_BUF_SIZE];
+  uint8_t mBatchCount = 0;
+  void *mBatchCtx = nullptr;
+  BatchReadCallback mBatchCb = nullptr;
+  int64_t mBatchStartMs = 0;
+  int64_t mBatchDeadline = 0;
+  struct {
+    struct k_work_delayable work;
+    BleDevice *dev;
+  } mBatchTimeoutWork;
+  struct k_work_sync mBatchTimeoutSync;
+  // Next request a Read Multiple Variable Length value belongs to.
+  uint8_t mBatchNext = 0;
+  uint8_t mBatchAttError = 0;
+  atomic_t mBatchPending = ATOMIC_INIT(0);
+  struct k_spinlock mBatchLock;
 
-  uint8_t mGattReadBuffer[GATT_READ_BUF_SIZE];
-  uint16_t mGattReadBufferSize = GATT_READ_BUF_SIZE;
-  uint16_t mGattReadSize = 0;
-  struct k_poll_signal mGattReadSignal;
-  struct k_poll_event mGattWaitEvents[1];
+  PendingWrite mPendingWrites[kMaxPendingWrites] = {};
+  uint8_t mWriteCredits = kWriteCredits;
+  bool mWriteRequestPending = false;
+  struct k_spinlock mWriteLock;
+  struct {
+    struct k_work_delayable work;
+    BleDevice *dev;
+  } mWriteWork;
+  struct k_work_sync mWriteSync;
 };
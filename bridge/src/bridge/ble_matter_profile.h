@@ -0,0 +1,158 @@
+#pragma once
+
+#include <app/util/af-types.h>
+#include <lib/core/DataModelTypes.h>
+#include <lib/support/Span.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#include <cstddef>
+#include <cstring>
+
+// Compile-time description of how a BLE peripheral is exposed as a bridged Matter device.
+// A profile lists the peripheral's primary service and, per characteristic, the Matter attribute it
+// feeds, how the value is converted and how it is accessed. Profiles and their endpoint
+// declarations are plain constant data, nothing is allocated or looked up in maps at runtime.
+namespace BleMatterProfile {
+
+enum class Access : uint8_t { READ_ONCE, SUBSCRIBE, WRITE };
+
+// Converts a characteristic value into the attribute value handed to the attribute cache. For
+// WRITE characteristics the other way round, the attribute value into the value written.
+// Returns the number of bytes written to out, 0 if the value cannot be converted.
+using ValueCodec = uint16_t (*)(const uint8_t *data, uint16_t length, uint8_t *out,
+                                uint16_t outSize);
+
+// Copies the value as is. The attribute cache zero-extends or truncates it to the attribute size.
+inline uint16_t RawCodec(const uint8_t *data, uint16_t length, uint8_t *out, uint16_t outSize) {
+  uint16_t copied = MIN(length, outSize);
+  memcpy(out, data, copied);
+  return copied;
+}
+
+// Little-endian uint16 saturated to an uint8, e.g. a percentage sent as uint16 into an INT8U level.
+inline uint16_t Uint16ToUint8Codec(const uint8_t *data, uint16_t length, uint8_t *out,
+                                   uint16_t outSize) {
+  if (length < sizeof(uint16_t) || outSize < sizeof(uint8_t)) {
+    return 0;
+  }
+  out[0] = MIN(sys_get_le16(data), UINT8_MAX);
+  return sizeof(uint8_t);
+}
+
+// Uint8 attribute into the posture checker's config, struct pcs_config of the posture checker
+// firmware. Its fields are placeholders so far, the value goes into the first one.
+inline uint16_t PcsConfigCodec(const uint8_t *data, uint16_t length, uint8_t *out,
+                               uint16_t outSize) {
+  constexpr uint16_t kPcsConfigSize = sizeof(uint32_t) + 2 * sizeof(uint8_t);
+  if (length < sizeof(uint8_t) || outSize < kPcsConfigSize) {
+    return 0;
+  }
+  memset(out, 0, kPcsConfigSize);
+  sys_put_le32(data[0], out);
+  return kPcsConfigSize;
+}
+
+struct Characteristic {
+  chip::ClusterId clusterId;
+  chip::AttributeId attributeId;
+  Access access;
+  const bt_uuid *uuid;
+  ValueCodec codec;
+};
+
+// Rolling statistics of a SUBSCRIBE characteristic, kept by the bridge over the last window
+// samples. The derived attributes of the characteristic's cluster are updated every hop samples
+// instead of the characteristic's own attribute on every notification. Attributes that are not
+// wanted are set to chip::kInvalidAttributeId.
+struct Aggregation {
+  uint8_t characteristic;  // Index into the profile's characteristics
+  uint8_t window;
+  uint8_t hop;
+  chip::AttributeId minAttributeId;
+  chip::AttributeId meanAttributeId;
+  chip::AttributeId maxAttributeId;
+};
+
+// Link to a connected peripheral. Discovery and the initial reads run with short intervals, then
+// the link is relaxed to what the peripheral's notifications need, which leaves the radio to the
+// other connections, scanning and CHIPoBLE. Intervals are in units of 1.25 ms and the supervision
+// timeout in units of 10 ms, as in struct bt_le_conn_param.
+struct LinkProfile {
+  bt_le_conn_param discovery;
+  bt_le_conn_param idle;
+  // BT_GAP_LE_PHY_* preferred in both directions, BT_GAP_LE_PHY_NONE keeps the PHY.
+  uint8_t phy;
+  // Longest link layer payload, 0 keeps the default of 27 bytes.
+  uint16_t maxTxOctets;
+};
+
+struct Profile {
+  const char *name;
+  const bt_uuid *serviceUuid;
+  const Characteristic *characteristics;
+  uint8_t characteristicCount;
+  uint8_t subscriptionCount;
+  const Aggregation *aggregations;
+  uint8_t aggregationCount;
+  const LinkProfile *link;
+  EmberAfEndpointType *ep;
+  const chip::Span<const EmberAfDeviceType> *deviceTypes;
+  const chip::Span<chip::DataVersion> *dataVersions;
+};
+
+template <size_t N>
+constexpr uint8_t CountAccess(const Characteristic (&characteristics)[N], Access access) {
+  uint8_t count = 0;
+  for (size_t i = 0; i < N; i++) {
+    if (characteristics[i].access == access) {
+      count++;
+    }
+  }
+  return count;
+}
+
+}  // namespace BleMatterProfile
+
+// Declares the dynamic endpoint of a bridged device type together with its data versions and the
+// spans handed to emberAfSetDynamicEndpoint. Every device gets its own data versions, even if
+// several devices share the same cluster list.
+#define DECLARE_BRIDGED_ENDPOINT(name, clusterList, deviceTypeList)                    \
+  DECLARE_DYNAMIC_ENDPOINT(name##Endpoint, clusterList);                               \
+  chip::DataVersion name##DataVersions[ArraySize(clusterList)];                        \
+  const chip::Span<const EmberAfDeviceType> name##DeviceTypesSpan(deviceTypeList);     \
+  const chip::Span<chip::DataVersion> name##DataVersionsSpan(name##DataVersions)
+
+#define DECLARE_BLE_MATTER_PROFILE_INTERNAL(name, label, clusterList, deviceTypeList, service,   \
+                                            characteristicList, aggregations, aggregationCount, \
+                                            link)                                               \
+  DECLARE_BRIDGED_ENDPOINT(name, clusterList, deviceTypeList);                                  \
+  static_assert(ArraySize(characteristicList) <= 32, "Too many characteristics in profile");    \
+  constexpr BleMatterProfile::Profile name##Profile = {                                         \
+      label,                                                                                    \
+      service,                                                                                  \
+      characteristicList,                                                                       \
+      ArraySize(characteristicList),                                                            \
+      BleMatterProfile::CountAccess(characteristicList, BleMatterProfile::Access::SUBSCRIBE),    \
+      aggregations,                                                                             \
+      aggregationCount,                                                                         \
+      link,                                                                                     \
+      &name##Endpoint,                                                                          \
+      &name##DeviceTypesSpan,                                                                   \
+      &name##DataVersionsSpan}
+
+// Declares the bridged endpoint and the profile `name##Profile` of a BLE peripheral. link may be
+// nullptr to keep the parameters the connection was created with.
+#define DECLARE_BLE_MATTER_PROFILE(name, label, clusterList, deviceTypeList, service,   \
+                                   characteristicList, link)                             \
+  DECLARE_BLE_MATTER_PROFILE_INTERNAL(name, label, clusterList, deviceTypeList, service, \
+                                      characteristicList, nullptr, 0, link)
+
+// Same for a peripheral with rolling statistics of some of its characteristics.
+#define DECLARE_AGGREGATED_BLE_MATTER_PROFILE(name, label, clusterList, deviceTypeList, service,  \
+                                              characteristicList, aggregationList, link)        \
+  DECLARE_BLE_MATTER_PROFILE_INTERNAL(name, label, clusterList, deviceTypeList, service,        \
+                                      characteristicList, aggregationList,                      \
+                                      ArraySize(aggregationList), link)
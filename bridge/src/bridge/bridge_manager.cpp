@@ -8,17 +8,80 @@
 #include <platform/PlatformManager.h>
 #include <zephyr/logging/log.h>
 
-#include <map>
-
 #include "ble_connectivity_manager.h"
+#include "bridge_trace.h"
+#include "device_registry.h"
 #include "matter_device.h"
 #include "matter_device_ble.h"
 LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
 
 using namespace ::chip::app::Clusters;
 
+static void ReportFlushWorkEntry(struct k_work *work) {
+  chip::DeviceLayer::PlatformMgr().ScheduleWork(
+      [](intptr_t context) {
+        BridgeManager::Instance().HandleUpdate(static_cast<uint32_t>(context));
+      },
+      static_cast<intptr_t>(k_cycle_get_32()));
+}
+
+static void LivenessWorkEntry(struct k_work *work) {
+  chip::DeviceLayer::PlatformMgr().ScheduleWork(
+      [](intptr_t context) { BridgeManager::Instance().CheckLiveness(); },
+      reinterpret_cast<intptr_t>(nullptr));
+}
+
+BridgeManager::BridgeManager() {
+  k_work_init_delayable(&mReportFlushWork, ReportFlushWorkEntry);
+  k_work_init_delayable(&mLivenessWork, LivenessWorkEntry);
+
+  for (uint8_t i = 0; i < kFreeSlotWords; i++) {
+    mFreeSlots[i] = 0;
+  }
+  for (uint8_t i = 0; i < kMaxDynamicEndpoints; i++) {
+    mFreeSlots[i / 32] |= BIT(i % 32);
+  }
+}
+
+int BridgeManager::AllocateIndex() {
+  for (uint8_t i = 0; i < kFreeSlotWords; i++) {
+    if (mFreeSlots[i]) {
+      uint8_t bit = __builtin_ctz(mFreeSlots[i]);
+      mFreeSlots[i] &= ~BIT(bit);
+      return i * 32 + bit;
+    }
+  }
+  return -1;
+}
+
+void BridgeManager::FreeIndex(uint8_t index) {
+  mDevices[index] = nullptr;
+  mStartedSlots[index / 32] &= ~BIT(index % 32);
+  mFreeSlots[index / 32] |= BIT(index % 32);
+}
+
+int BridgeManager::FindIndex(MatterDevice *dev) const {
+  for (uint8_t i = 0; i < kMaxDynamicEndpoints; i++) {
+    if (mDevices[i] == dev) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+chip::EndpointId BridgeManager::NextEndpointId() {
+  // Endpoint ids of stored devices stay reserved, even while those devices are not added.
+  while (DeviceRegistry::Instance().IsEndpointIdTaken(mCurrentEndpointId)) {
+    mCurrentEndpointId++;
+  }
+  return mCurrentEndpointId++;
+}
+
 CHIP_ERROR BridgeManager::Init(struct MatterDeviceBle::MatterDeviceConfiguration conf, struct MatterDeviceFixed::MatterDeviceConfiguration conf2) {
   LOG_INF("BridgeManager::Init");
+  VerifyOrReturnError(!mInitialized, CHIP_ERROR_INCORRECT_STATE, LOG_WRN("Already initialized"));
+  mInitialized = true;
+
   CHIP_ERROR err;
   // Set starting endpoint id where dynamic endpoints will be assigned, which
   // will be the next consecutive endpoint id after the last fixed endpoint.
@@ -32,10 +95,8 @@ CHIP_ERROR BridgeManager::Init(struct MatterDeviceBle::MatterDeviceConfiguration
   emberAfEndpointEnableDisable(
       emberAfEndpointFromIndex(static_cast<uint16_t>(emberAfFixedEndpointCount() - 1)), false);
 
-  err = BLEConnectivityManager::Instance().Init();
-  if (err != CHIP_NO_ERROR) {
-    return err;
-  }
+  DeviceRegistry::Instance().Load();
+  k_work_schedule(&mLivenessWork, K_MSEC(kLivenessCheckIntervalMs));
 
   MatterDeviceBle *dev = chip::Platform::New<MatterDeviceBle>(conf);
   err = AddDeviceEndpoint(dev);
@@ -48,44 +109,112 @@ CHIP_ERROR BridgeManager::Init(struct MatterDeviceBle::MatterDeviceConfiguration
   return err;
 }
 
+void BridgeManager::SetReady(uint8_t signals) {
+  uint8_t added = signals & ~mReadySignals;
+  VerifyOrReturn(added);
+
+  static constexpr struct {
+    uint8_t signal;
+    const char *name;
+    int64_t StartupStats::*uptimeMs;
+  } kSignals[] = {
+      {kBridgeBtReady, "BT ready", &StartupStats::btReadyMs},
+      {kBridgeNetworkUp, "network up", &StartupStats::networkUpMs},
+      {kBridgeTimeSynced, "time synced", &StartupStats::timeSyncedMs},
+      {kBridgeStorageMounted, "storage mounted", &StartupStats::storageMountedMs},
+  };
+  int64_t now = k_uptime_get();
+  for (const auto &entry : kSignals) {
+    if (added & entry.signal) {
+      mStartupStats.*entry.uptimeMs = now;
+      LOG_INF("BridgeManager: %s after %lld ms", entry.name, now);
+    }
+  }
+
+  if (added & kBridgeBtReady) {
+    if (BLEConnectivityManager::Instance().Init() != CHIP_NO_ERROR) {
+      LOG_ERR("BLEConnectivityManager initialization failed");
+      added &= ~kBridgeBtReady;
+    }
+  }
+  mReadySignals |= added;
+
+  for (uint8_t i = 0; i < kMaxDynamicEndpoints; i++) {
+    StartDevice(i);
+  }
+}
+
+void BridgeManager::StartDevice(uint8_t index) {
+  MatterDevice *dev = mDevices[index];
+  if (!dev || (mStartedSlots[index / 32] & BIT(index % 32))) {
+    return;
+  }
+  uint8_t requirements = dev->GetStartRequirements();
+  if ((mReadySignals & requirements) != requirements) {
+    return;
+  }
+
+  LOG_INF("BridgeManager: start device %s", dev->GetName());
+  mStartedSlots[index / 32] |= BIT(index % 32);
+  dev->Init();
+}
+
 CHIP_ERROR BridgeManager::AddDeviceEndpoint(MatterDevice *dev) {
   LOG_INF("BridgeManager::AddDeviceEndpoint");
 
-  for (const auto &[key, value] : Instance().mDevicesMap) {
-    if (value == dev) {
-      LOG_WRN("Device already added!");
-      return CHIP_ERROR_INTERNAL;
-    }
+  if (Instance().FindIndex(dev) >= 0) {
+    LOG_WRN("Device already added!");
+    return CHIP_ERROR_INTERNAL;
   }
 
   chip::DeviceLayer::PlatformMgr().ScheduleWork(
       [](intptr_t context) {
         EmberAfStatus ret;
 
-        uint8_t index = 0;
-        while (true) {
-          if (!Instance().mDevicesMap.contains(index)) {
-            break;
-          }
-          index++;
+        MatterDevice *dev = reinterpret_cast<MatterDevice *>(context);
+
+        int index = Instance().AllocateIndex();
+        if (index < 0) {
+          LOG_ERR("No free dynamic endpoint index for device %s", dev->GetName());
+          return;
         }
 
-        MatterDevice *dev = reinterpret_cast<MatterDevice *>(context);
+        BridgeManager &manager = BridgeManager::Instance();
+        DeviceRegistry &registry = DeviceRegistry::Instance();
+        chip::EndpointId endpointId = dev->IsPersistent() ? registry.FindEndpointId(dev->GetName())
+                                                          : chip::kInvalidEndpointId;
+        bool known = endpointId != chip::kInvalidEndpointId;
+        if (!known) {
+          endpointId = manager.NextEndpointId();
+        }
+
+        dev->SetEndpointId(endpointId);
+        if (dev->InitAttributeCache() != CHIP_NO_ERROR) {
+          LOG_WRN("Attribute cache of device %s is incomplete", dev->GetName());
+        }
+        if (known) {
+          registry.RestoreAttributes(dev);
+        }
 
-        dev->SetEndpointId(BridgeManager::Instance().mCurrentEndpointId);
-        
         // Register dyanmic matter device
-        ret = emberAfSetDynamicEndpoint(index, BridgeManager::Instance().mCurrentEndpointId,
-                                        dev->GetEndpoint(), *(dev->GetDataVersions()),
-                                        *(dev->GetDeviceTypes()), aggregatorEndpointId);
+        ret = emberAfSetDynamicEndpoint(index, endpointId, dev->GetEndpoint(),
+                                        *(dev->GetDataVersions()), *(dev->GetDeviceTypes()),
+                                        aggregatorEndpointId);
 
         if (ret == EMBER_ZCL_STATUS_SUCCESS) {
-          LOG_INF("Added device %s to dynamic endpoint %d (index=%d)", dev->GetName(),
-                  BridgeManager::Instance().mCurrentEndpointId, index);
-          dev->Init();
-          BridgeManager::Instance().mDevicesMap[index] = dev;
+          LOG_INF("Added device %s to dynamic endpoint %d (index=%d%s)", dev->GetName(), endpointId,
+                  index, dev->GetIsStale() ? ", stale" : "");
+          manager.mDevices[index] = dev;
+          if (manager.mStartupStats.endpointsMs < 0) {
+            manager.mStartupStats.endpointsMs = k_uptime_get();
+          }
+          manager.StartDevice(index);
+          if (!known) {
+            registry.ScheduleStore(index);
+          }
+        } else {
+          manager.FreeIndex(index);
         }
-        BridgeManager::Instance().mCurrentEndpointId++;
       },
       reinterpret_cast<intptr_t>(dev));
 
@@ -97,43 +226,168 @@ void BridgeManager::RemoveDeviceEndpoint(MatterDevice *dev) {
   chip::DeviceLayer::PlatformMgr().ScheduleWork(
       [](intptr_t context) {
         MatterDevice *dev = reinterpret_cast<MatterDevice *>(context);
-        auto findResult = std::find_if(
-            std::begin(BridgeManager::Instance().mDevicesMap),
-            std::end(BridgeManager::Instance().mDevicesMap),
-            [&](const std::pair<uint8_t, MatterDevice *> &pair) { return pair.second == dev; });
-
-        uint8_t index = -1;
-        if (findResult != std::end(BridgeManager::Instance().mDevicesMap)) {
-          index = findResult->first;
-        }
+
+        int index = BridgeManager::Instance().FindIndex(dev);
         if (index >= 0) {
           chip::EndpointId ep = emberAfClearDynamicEndpoint((uint16_t)index);
           LOG_INF("Remove device %s from dynamic endpoint %d (index=%d)", dev->GetName(), ep,
                   (uint16_t)index);
+          if (dev->IsPersistent()) {
+            DeviceRegistry::Instance().Remove(dev->GetName());
+          }
           chip::Platform::Delete(dev);
-          BridgeManager::Instance().mDevicesMap.erase(index);
+          BridgeManager::Instance().FreeIndex(index);
         }
       },
       reinterpret_cast<intptr_t>(dev));
 }
 
-void BridgeManager::HandleUpdate(chip::app::ConcreteAttributePath *path) {
-  LOG_INF("BridgeManager::HandleUpdate");
-  MatterReportingAttributeChangeCallback(*path);
-  chip::Platform::Delete(path);
+void BridgeManager::ReportAttributeChange(chip::EndpointId endpointId, chip::ClusterId clusterId,
+                                          chip::AttributeId attributeId,
+                                          uint32_t receivedCyc, uint32_t cachedCyc) {
+  bool scheduleDrain = false;
+
+  k_spinlock_key_t key = k_spin_lock(&mReportLock);
+  bool pending = false;
+  for (uint16_t i = 0; i < mReportCount; i++) {
+    const auto &queued = mPendingReports[(mReportHead + i) % kReportQueueSize].path;
+    if (queued.mEndpointId == endpointId && queued.mClusterId == clusterId &&
+        queued.mAttributeId == attributeId) {
+      pending = true;
+      break;
+    }
+  }
+
+  if (pending) {
+    mReportStats.coalesced++;
+  } else if (mReportCount < kReportQueueSize) {
+    mPendingReports[(mReportHead + mReportCount) % kReportQueueSize] = {
+        chip::app::ConcreteAttributePath(endpointId, clusterId, attributeId), receivedCyc,
+        cachedCyc};
+    mReportCount++;
+    if (mReportCount > mReportStats.highWaterMark) {
+      mReportStats.highWaterMark = mReportCount;
+    }
+  } else {
+    // The value is cached already, its change must not get lost.
+    mReportStats.overflows++;
+    bool dirty = mAllEndpointsDirty;
+    for (uint8_t i = 0; i < mDirtyEndpointCount && !dirty; i++) {
+      dirty = mDirtyEndpoints[i] == endpointId;
+    }
+    if (!dirty && mDirtyEndpointCount < ARRAY_SIZE(mDirtyEndpoints)) {
+      mDirtyEndpoints[mDirtyEndpointCount++] = endpointId;
+    } else if (!dirty) {
+      mAllEndpointsDirty = true;
+    }
+  }
+  if (!mReportDrainScheduled) {
+    mReportDrainScheduled = true;
+    scheduleDrain = true;
+  }
+  k_spin_unlock(&mReportLock, key);
+
+  if (scheduleDrain) {
+    k_work_schedule(&mReportFlushWork, K_MSEC(kReportCoalesceWindowMs));
+  }
+}
+
+void BridgeManager::NoteUnchangedAttribute() {
+  k_spinlock_key_t key = k_spin_lock(&mReportLock);
+  mReportStats.unchanged++;
+  k_spin_unlock(&mReportLock, key);
+}
+
+void BridgeManager::CheckLiveness() {
+  int64_t nowMs = k_uptime_get();
+  for (uint8_t i = 0; i < kMaxDynamicEndpoints; i++) {
+    if (mDevices[i] && (mStartedSlots[i / 32] & BIT(i % 32))) {
+      mDevices[i]->CheckLiveness(nowMs);
+    }
+  }
+  // A device is detected at most one period after its timeout passed.
+  k_work_schedule(&mLivenessWork, K_MSEC(kLivenessCheckIntervalMs));
+}
+
+void BridgeManager::HandleUpdate(uint32_t scheduledCyc) {
+  uint32_t dispatchedCyc = k_cycle_get_32();
+  chip::EndpointId dirtyEndpoints[kMaxDynamicEndpoints];
+  uint8_t dirtyEndpointCount = 0;
+  bool allEndpointsDirty = false;
+  while (true) {
+    PendingReport report;
+
+    k_spinlock_key_t key = k_spin_lock(&mReportLock);
+    if (mReportCount == 0) {
+      // Overflows after this point schedule the next drain.
+      memcpy(dirtyEndpoints, mDirtyEndpoints, mDirtyEndpointCount * sizeof(mDirtyEndpoints[0]));
+      dirtyEndpointCount = mDirtyEndpointCount;
+      allEndpointsDirty = mAllEndpointsDirty;
+      mDirtyEndpointCount = 0;
+      mAllEndpointsDirty = false;
+      mReportDrainScheduled = false;
+      k_spin_unlock(&mReportLock, key);
+      break;
+    }
+    report = mPendingReports[mReportHead];
+    mReportHead = (mReportHead + 1) % kReportQueueSize;
+    mReportCount--;
+    k_spin_unlock(&mReportLock, key);
+
+    const chip::app::ConcreteAttributePath &path = report.path;
+    if (mStartupStats.firstReportMs < 0 && path.mClusterId != BridgedDeviceBasicInformation::Id) {
+      mStartupStats.firstReportMs = k_uptime_get();
+      LOG_INF("BridgeManager: first report after %lld ms", mStartupStats.firstReportMs);
+    }
+    BRIDGE_TRACE(REPORT, path.mEndpointId, path.mClusterId, path.mAttributeId);
+    MatterReportingAttributeChangeCallback(path);
+    uint32_t reportedCyc = k_cycle_get_32();
+
+    // Reports queued while draining were not waiting for this drain to be scheduled, their
+    // coalesce and dispatch stages count as 0.
+    MatterDevice *dev = GetDevice(emberAfGetDynamicIndexFromEndpoint(path.mEndpointId));
+    if (dev) {
+      dev->GetLatency(MatterDevice::kLatencyCoalesce).RecordCycles(report.cachedCyc, scheduledCyc);
+      dev->GetLatency(MatterDevice::kLatencyDispatch).RecordCycles(scheduledCyc, dispatchedCyc);
+      dev->GetLatency(MatterDevice::kLatencyReport).RecordCycles(dispatchedCyc, reportedCyc);
+      dev->GetLatency(MatterDevice::kLatencyTotal).RecordCycles(report.receivedCyc, reportedCyc);
+    }
+  }
+
+  if (allEndpointsDirty) {
+    for (uint8_t i = 0; i < kMaxDynamicEndpoints; i++) {
+      if (mDevices[i]) {
+        ReportEndpoint(mDevices[i]->GetEndpointId());
+      }
+    }
+  } else {
+    for (uint8_t i = 0; i < dirtyEndpointCount; i++) {
+      ReportEndpoint(dirtyEndpoints[i]);
+    }
+  }
+}
+
+void BridgeManager::ReportEndpoint(chip::EndpointId endpointId) {
+  LOG_INF("BridgeManager: report endpoint %d after a report queue overflow", endpointId);
+  // Reporting a whole endpoint leaves the data versions alone, subscribers compare them.
+  MatterDevice *dev = GetDevice(emberAfGetDynamicIndexFromEndpoint(endpointId));
+  if (dev) {
+    for (chip::DataVersion &version : *dev->GetDataVersions()) {
+      version++;
+    }
+  }
+  MatterReportingAttributeChangeCallback(endpointId);
 }
 
 // Value read/write Matter -> BleDevice
 CHIP_ERROR BridgeManager::HandleRead(uint16_t index, chip::ClusterId clusterId,
                                      const EmberAfAttributeMetadata *attributeMetadata,
                                      uint8_t *buffer, uint16_t maxReadLength) {
-  LOG_INF("BridgeManager::HandleRead");
   VerifyOrReturnError(attributeMetadata && buffer, CHIP_ERROR_INVALID_ARGUMENT,
                       LOG_ERR("No attributeMetadata or buffer."));
-  VerifyOrReturnValue(Instance().mDevicesMap.contains(index), CHIP_ERROR_INTERNAL,
-                      LOG_ERR("No device for index %d", index));
-
-  auto *device = Instance().mDevicesMap[index];
+  BRIDGE_TRACE(BRIDGE_READ, index, clusterId, attributeMetadata->attributeId);
+  auto *device = Instance().GetDevice(index);
+  VerifyOrReturnValue(device, CHIP_ERROR_INTERNAL, LOG_ERR("No device for index %d", index));
 
   /* Handle reads for the generic information for all bridged devices. Provide a valid answer even
    * if device state is unreachable. */
@@ -157,19 +411,18 @@ CHIP_ERROR BridgeManager::HandleRead(uint16_t index, chip::ClusterId clusterId,
 CHIP_ERROR BridgeManager::HandleWrite(uint16_t index, chip::ClusterId clusterId,
                                       const EmberAfAttributeMetadata *attributeMetadata,
                                       uint8_t *buffer) {
-  LOG_INF("BridgeManager::HandleRead");
   VerifyOrReturnError(attributeMetadata && buffer, CHIP_ERROR_INVALID_ARGUMENT,
                       LOG_ERR("No attributeMetadata or buffer."));
-  VerifyOrReturnValue(Instance().mDevicesMap.contains(index), CHIP_ERROR_INTERNAL,
-                      LOG_ERR("No device for index %d", index));
-
-  auto *device = Instance().mDevicesMap[index];
+  BRIDGE_TRACE(BRIDGE_WRITE, index, clusterId, attributeMetadata->attributeId);
+  auto *device = Instance().GetDevice(index);
+  VerifyOrReturnValue(device, CHIP_ERROR_INTERNAL, LOG_ERR("No device for index %d", index));
 
   /* Verify if the device is reachable or we should return prematurely. */
   VerifyOrReturnError(device->GetIsReachable(), CHIP_ERROR_INCORRECT_STATE,
                       LOG_ERR("Device is not reachable."));
 
-  CHIP_ERROR err = device->HandleWrite(clusterId, attributeMetadata->attributeId, buffer);
+  CHIP_ERROR err = device->HandleWrite(clusterId, attributeMetadata->attributeId, buffer,
+                                       attributeMetadata->size);
 
   return err;
 }
@@ -179,8 +432,8 @@ EmberAfStatus emberAfExternalAttributeReadCallback(
     chip::EndpointId endpoint, chip::ClusterId clusterId,
     const EmberAfAttributeMetadata *attributeMetadata, uint8_t *buffer, uint16_t maxReadLength) {
   uint16_t endpointIndex = emberAfGetDynamicIndexFromEndpoint(endpoint);
-  LOG_INF("emberAfExternalAttributeReadCallback with endpoint %d, clusterId %d, endpointIndex %d",
-          endpoint, clusterId, endpointIndex);
+  BRIDGE_TRACE(ATTRIBUTE_READ, endpoint, clusterId,
+               attributeMetadata ? attributeMetadata->attributeId : chip::kInvalidAttributeId);
 
   if (CHIP_NO_ERROR == BridgeManager::Instance().HandleRead(
                            endpointIndex, clusterId, attributeMetadata, buffer, maxReadLength)) {
@@ -194,8 +447,8 @@ EmberAfStatus emberAfExternalAttributeWriteCallback(
     chip::EndpointId endpoint, chip::ClusterId clusterId,
     const EmberAfAttributeMetadata *attributeMetadata, uint8_t *buffer) {
   uint16_t endpointIndex = emberAfGetDynamicIndexFromEndpoint(endpoint);
-  LOG_INF("emberAfExternalAttributeWriteCallback with endpoint %d, clusterId %d, endpointIndex %d",
-          endpoint, clusterId, endpointIndex);
+  BRIDGE_TRACE(ATTRIBUTE_WRITE, endpoint, clusterId,
+               attributeMetadata ? attributeMetadata->attributeId : chip::kInvalidAttributeId);
 
   if (CHIP_NO_ERROR ==
       BridgeManager::Instance().HandleWrite(endpointIndex, clusterId, attributeMetadata, buffer)) {
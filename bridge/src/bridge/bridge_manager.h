@@ -1,9 +1,9 @@
 #pragma once
 
 #include <app/util/af-types.h>
+#include <app/ConcreteAttributePath.h>
 #include <lib/core/DataModelTypes.h>
-
-#include <map>
+#include <zephyr/spinlock.h>
 
 #include "matter_device.h"
 #include "matter_device_ble.h"
@@ -13,15 +13,64 @@ class BridgeManager {
  public:
   // https://github.com/nrfconnect/sdk-nrf/commit/390c3f93d63444f39477ecc6a5dfd43caa773152
   static constexpr chip::EndpointId aggregatorEndpointId = CONFIG_BRIDGE_AGGREGATOR_ENDPOINT_ID;
+  static constexpr uint8_t kMaxDynamicEndpoints = CONFIG_BRIDGE_MAX_DYNAMIC_ENDPOINTS_NUMBER;
+  static constexpr uint16_t kReportQueueSize = CONFIG_BRIDGE_REPORT_QUEUE_SIZE;
+  static constexpr uint32_t kReportCoalesceWindowMs = CONFIG_BRIDGE_REPORT_COALESCE_WINDOW_MS;
+  static constexpr uint32_t kLivenessCheckIntervalMs = CONFIG_BRIDGE_LIVENESS_CHECK_INTERVAL_MS;
+
+  // Uptimes in ms, -1 until reached.
+  struct StartupStats {
+    int64_t endpointsMs;
+    int64_t btReadyMs;
+    int64_t networkUpMs;
+    int64_t timeSyncedMs;
+    int64_t storageMountedMs;
+    // First report of a device value, the point from which controllers see live data.
+    int64_t firstReportMs;
+  };
 
+  struct ReportQueueStats {
+    uint32_t overflows;
+    uint32_t coalesced;
+    uint32_t unchanged;
+    uint16_t highWaterMark;
+  };
+
+  // Register the dynamic endpoints of the bridged devices. Devices known from the device registry
+  // get their previous endpoint id back and serve their stored values right away.
   CHIP_ERROR Init(struct MatterDeviceBle::MatterDeviceConfiguration conf, struct MatterDeviceFixed::MatterDeviceConfiguration conf2);
+  // Note a readiness signal and start every device whose requirements are met by now. Devices
+  // added later are started as soon as they are added. Must be called on the CHIP thread.
+  void SetReady(uint8_t signals);
+  uint8_t GetReadySignals() const { return mReadySignals; }
 
   static BridgeManager &Instance() {
     static BridgeManager sInstance;
     return sInstance;
   }
 
-  void HandleUpdate(chip::app::ConcreteAttributePath *path);
+  // Queue an attribute change report. Safe to call from any thread, the queue is drained by
+  // HandleUpdate on the CHIP thread once the coalescing window has passed. A path that is already
+  // pending is not queued twice. If the queue is full, the endpoint is reported as a whole instead.
+  // receivedCyc and cachedCyc are the k_cycle_get_32 times the value arrived and was cached, they
+  // feed the latency histograms of the device. A coalesced report keeps the earliest times.
+  void ReportAttributeChange(chip::EndpointId endpointId, chip::ClusterId clusterId,
+                             chip::AttributeId attributeId, uint32_t receivedCyc,
+                             uint32_t cachedCyc);
+  void ReportAttributeChange(chip::EndpointId endpointId, chip::ClusterId clusterId,
+                             chip::AttributeId attributeId) {
+    uint32_t now = k_cycle_get_32();
+    ReportAttributeChange(endpointId, clusterId, attributeId, now, now);
+  }
+  // Count an update that was dropped because the cached value did not change.
+  void NoteUnchangedAttribute();
+  // Drain the report queue. scheduledCyc is the time the drain was handed to ScheduleWork.
+  void HandleUpdate(uint32_t scheduledCyc);
+  void ReportEndpoint(chip::EndpointId endpointId);
+  ReportQueueStats GetReportQueueStats() const { return mReportStats; }
+  // Run the liveness checks of all started devices, CHIP thread only.
+  void CheckLiveness();
+  StartupStats GetStartupStats() const { return mStartupStats; }
 
   CHIP_ERROR HandleRead(uint16_t index, chip::ClusterId clusterId,
                         const EmberAfAttributeMetadata *attributeMetadata, uint8_t *buffer,
@@ -29,11 +78,57 @@ class BridgeManager {
   CHIP_ERROR HandleWrite(uint16_t index, chip::ClusterId clusterId,
                          const EmberAfAttributeMetadata *attributeMetadata, uint8_t *buffer);
 
+  // Direct lookup by dynamic endpoint index, used on every attribute read/write.
+  MatterDevice *GetDevice(uint16_t index) const {
+    return index < kMaxDynamicEndpoints ? mDevices[index] : nullptr;
+  }
+
+  // Dynamic endpoint index of a registered device, -1 if not registered.
+  int FindIndex(MatterDevice *dev) const;
+
   chip::EndpointId mCurrentEndpointId;
-  std::map<uint8_t, MatterDevice *> mDevicesMap;
 
+  // Register a device on the next free dynamic endpoint. Safe to call from any thread, the device
+  // is added on the CHIP thread and owned by the BridgeManager from then on.
+  CHIP_ERROR AddDeviceEndpoint(MatterDevice *dev);
   void RemoveDeviceEndpoint(MatterDevice *dev);
 
  private:
-  CHIP_ERROR AddDeviceEndpoint(MatterDevice *dev);
+  static constexpr uint8_t kFreeSlotWords = (kMaxDynamicEndpoints + 31) / 32;
+
+  BridgeManager();
+
+  int AllocateIndex();
+  void FreeIndex(uint8_t index);
+  chip::EndpointId NextEndpointId();
+  void StartDevice(uint8_t index);
+
+  // Dispatch table indexed by dynamic endpoint index. A set bit in mFreeSlots marks a free index.
+  MatterDevice *mDevices[kMaxDynamicEndpoints] = {};
+  uint32_t mFreeSlots[kFreeSlotWords];
+  // A set bit marks a started device.
+  uint32_t mStartedSlots[kFreeSlotWords] = {};
+  bool mInitialized = false;
+  uint8_t mReadySignals = 0;
+  StartupStats mStartupStats = {-1, -1, -1, -1, -1, -1};
+
+  // Ring of pending report paths, filled from BT/timer context and drained on the CHIP thread.
+  struct PendingReport {
+    chip::app::ConcreteAttributePath path;
+    uint32_t receivedCyc;
+    uint32_t cachedCyc;
+  };
+  PendingReport mPendingReports[kReportQueueSize];
+  uint16_t mReportHead = 0;
+  uint16_t mReportCount = 0;
+  bool mReportDrainScheduled = false;
+  ReportQueueStats mReportStats = {};
+  // Endpoints that missed a report because the ring was full. The next drain reports them as a
+  // whole, all of them if more endpoints missed one than fit in here.
+  chip::EndpointId mDirtyEndpoints[kMaxDynamicEndpoints];
+  uint8_t mDirtyEndpointCount = 0;
+  bool mAllEndpointsDirty = false;
+  struct k_spinlock mReportLock;
+  struct k_work_delayable mReportFlushWork;
+  struct k_work_delayable mLivenessWork;
 };
@@ -0,0 +1,168 @@
+#include "bridge_simulation.h"
+
+#include <zephyr/logging/log.h>
+
+#include "latency_histogram.h"
+LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
+
+// Runs the simulated notifications with the priority of the BT RX thread.
+K_THREAD_STACK_DEFINE(sSimulationStack, CONFIG_BRIDGE_SIMULATION_STACK_SIZE);
+
+BridgeSimulation::BridgeSimulation() {
+  k_work_init_delayable(&mStepWork, StepWorkEntry);
+  k_work_queue_init(&mWorkQueue);
+  struct k_work_queue_config config = {.name = "bridge_sim"};
+  k_work_queue_start(&mWorkQueue, sSimulationStack, K_THREAD_STACK_SIZEOF(sSimulationStack),
+                     K_PRIO_COOP(CONFIG_BT_RX_PRIO), &config);
+}
+
+uint8_t BridgeSimulation::FreeEndpoints() const {
+  uint8_t free = 0;
+  for (uint8_t i = 0; i < BridgeManager::kMaxDynamicEndpoints; i++) {
+    if (!BridgeManager::Instance().GetDevice(i)) {
+      free++;
+    }
+  }
+  return free;
+}
+
+void BridgeSimulation::AddDevices(uint8_t count) {
+  for (uint8_t i = 0; i < count && mDeviceCount < kMaxDevices; i++) {
+    struct MatterDeviceSim::MatterDeviceConfiguration conf = {mProfile, mNextId++, mIntervalMs,
+                                                              &mWorkQueue};
+    MatterDeviceSim *dev = chip::Platform::New<MatterDeviceSim>(conf);
+    VerifyOrReturn(dev, LOG_ERR("BridgeSimulation: out of memory after %d devices", mDeviceCount));
+    mDevices[mDeviceCount++] = dev;
+    BridgeManager::Instance().AddDeviceEndpoint(dev);
+  }
+}
+
+void BridgeSimulation::RemoveDevices() {
+  for (uint8_t i = 0; i < mDeviceCount; i++) {
+    BridgeManager::Instance().RemoveDeviceEndpoint(mDevices[i]);
+    mDevices[i] = nullptr;
+  }
+  mDeviceCount = 0;
+}
+
+void BridgeSimulation::ResetCounters() {
+  for (uint8_t i = 0; i < mDeviceCount; i++) {
+    mDevices[i]->ResetCounters();
+    mDevices[i]->ResetLatency();
+    mDevices[i]->ResetNotificationStats();
+  }
+  mReportBaseline = BridgeManager::Instance().GetReportQueueStats();
+  mStartMs = k_uptime_get();
+}
+
+void BridgeSimulation::Collect(Sample &sample) {
+  LatencyHistogram total;
+  sample = {};
+  sample.devices = mDeviceCount;
+  sample.elapsedMs = k_uptime_get() - mStartMs;
+  for (uint8_t i = 0; i < mDeviceCount; i++) {
+    MatterDeviceSim::Counters counters = mDevices[i]->GetCounters();
+    sample.notifications += counters.notifications;
+    sample.overruns += counters.overruns;
+    sample.dropped += mDevices[i]->GetNotificationStats().dropped;
+    total.Merge(mDevices[i]->GetLatency(MatterDevice::kLatencyTotal));
+  }
+  BridgeManager::ReportQueueStats stats = BridgeManager::Instance().GetReportQueueStats();
+  sample.reports = total.GetCount();
+  sample.coalesced = stats.coalesced - mReportBaseline.coalesced;
+  sample.overflows = stats.overflows - mReportBaseline.overflows;
+  sample.p50Us = total.GetPercentileUs(50);
+  sample.p99Us = total.GetPercentileUs(99);
+  sample.maxUs = total.GetMaxUs();
+}
+
+CHIP_ERROR BridgeSimulation::Start(uint8_t count, uint32_t intervalMs) {
+  VerifyOrReturnError(mProfile, CHIP_ERROR_INCORRECT_STATE);
+  VerifyOrReturnError(mPhase == Phase::IDLE, CHIP_ERROR_BUSY);
+  VerifyOrReturnError(count > 0 && count <= FreeEndpoints() && intervalMs > 0,
+                      CHIP_ERROR_INVALID_ARGUMENT);
+
+  mPhase = Phase::RUNNING;
+  mIntervalMs = intervalMs;
+  AddDevices(count);
+  ResetCounters();
+  return CHIP_NO_ERROR;
+}
+
+CHIP_ERROR BridgeSimulation::Stop(Sample &sample) {
+  VerifyOrReturnError(mPhase == Phase::RUNNING, CHIP_ERROR_INCORRECT_STATE);
+
+  Collect(sample);
+  RemoveDevices();
+  mPhase = Phase::IDLE;
+  return CHIP_NO_ERROR;
+}
+
+CHIP_ERROR BridgeSimulation::Silence(uint8_t count) {
+  VerifyOrReturnError(mPhase == Phase::RUNNING, CHIP_ERROR_INCORRECT_STATE);
+  VerifyOrReturnError(count <= mDeviceCount, CHIP_ERROR_INVALID_ARGUMENT);
+
+  for (uint8_t i = 0; i < mDeviceCount; i++) {
+    mDevices[i]->SetSilent(i < count);
+  }
+  return CHIP_NO_ERROR;
+}
+
+CHIP_ERROR BridgeSimulation::Benchmark(uint32_t intervalMs, uint32_t stepMs) {
+  VerifyOrReturnError(mProfile, CHIP_ERROR_INCORRECT_STATE);
+  VerifyOrReturnError(mPhase == Phase::IDLE, CHIP_ERROR_BUSY);
+  VerifyOrReturnError(intervalMs > 0 && stepMs > 0, CHIP_ERROR_INVALID_ARGUMENT);
+
+  mMaxCount = MIN(FreeEndpoints(), kMaxDevices);
+  VerifyOrReturnError(mMaxCount > 0, CHIP_ERROR_NO_MEMORY);
+
+  LOG_INF("BridgeSimulation: benchmark up to %d devices, notify every %u ms, %u ms per step",
+          mMaxCount, intervalMs, stepMs);
+  mIntervalMs = intervalMs;
+  mStepMs = stepMs;
+  mSampleCount = 0;
+  mPhase = Phase::SETTLE;
+  AddDevices(1);
+  k_work_schedule(&mStepWork, K_MSEC(kSettleMs));
+  return CHIP_NO_ERROR;
+}
+
+void BridgeSimulation::StepWorkEntry(struct k_work *work) { Instance().Step(); }
+
+void BridgeSimulation::Step() {
+  switch (mPhase) {
+    case Phase::SETTLE:
+      ResetCounters();
+      mPhase = Phase::MEASURE;
+      k_work_schedule(&mStepWork, K_MSEC(mStepMs));
+      break;
+    case Phase::MEASURE: {
+      Sample &sample = mSamples[mSampleCount < kMaxSamples ? mSampleCount++ : kMaxSamples - 1];
+      Collect(sample);
+      LOG_INF("BridgeSimulation: %d devices, %u notifications, %u reports in %u ms, %u overruns, "
+              "%u notifications dropped, %u coalesced, %u reports dropped, p50 <%u us, "
+              "p99 <%u us, max %u us",
+              sample.devices, sample.notifications, sample.reports, sample.elapsedMs,
+              sample.overruns, sample.dropped, sample.coalesced, sample.overflows, sample.p50Us,
+              sample.p99Us, sample.maxUs);
+      RemoveDevices();
+      if (sample.devices >= mMaxCount) {
+        LOG_INF("BridgeSimulation: benchmark done");
+        mPhase = Phase::IDLE;
+        break;
+      }
+      mPhase = Phase::DRAIN;
+      k_work_schedule(&mStepWork, K_MSEC(kSettleMs));
+      break;
+    }
+    case Phase::DRAIN: {
+      uint8_t previous = mSamples[mSampleCount - 1].devices;
+      AddDevices(MIN(previous * 2, mMaxCount));
+      mPhase = Phase::SETTLE;
+      k_work_schedule(&mStepWork, K_MSEC(kSettleMs));
+      break;
+    }
+    default:
+      break;
+  }
+}
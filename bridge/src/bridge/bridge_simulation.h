@@ -0,0 +1,90 @@
+#pragma once
+
+#include <lib/core/CHIPError.h>
+#include <zephyr/kernel.h>
+
+#include "ble_matter_profile.h"
+#include "bridge_manager.h"
+#include "matter_device_sim.h"
+
+// Load test of the bridge with simulated peripherals, see MatterDeviceSim. Either runs a fixed
+// number of devices until stopped, or sweeps the device count from 1 up to the free dynamic
+// endpoints and measures each step: notifications, reports, report queue drops and the latency
+// from notification to report.
+class BridgeSimulation {
+ public:
+  static constexpr uint8_t kMaxDevices = BridgeManager::kMaxDynamicEndpoints;
+  static constexpr uint8_t kMaxSamples = 8;
+  // Time given to the CHIP thread to add or remove the devices of a step.
+  static constexpr uint32_t kSettleMs = 1000;
+
+  struct Sample {
+    uint8_t devices;
+    uint32_t elapsedMs;
+    uint32_t notifications;
+    uint32_t overruns;
+    // Notifications dropped by full notification rings.
+    uint32_t dropped;
+    uint32_t reports;
+    uint32_t coalesced;
+    uint32_t overflows;
+    uint32_t p50Us;
+    uint32_t p99Us;
+    uint32_t maxUs;
+  };
+
+  static BridgeSimulation &Instance() {
+    static BridgeSimulation sInstance;
+    return sInstance;
+  }
+
+  // Profile the simulated devices expose.
+  void SetProfile(const BleMatterProfile::Profile *profile) { mProfile = profile; }
+
+  // Add count devices notifying every intervalMs until Stop is called.
+  CHIP_ERROR Start(uint8_t count, uint32_t intervalMs);
+  // Measure the running simulation and remove its devices.
+  CHIP_ERROR Stop(Sample &sample);
+  // Silence the first count devices of the running simulation, the others notify (again). Their
+  // detection shows in the liveness statistics of the devices.
+  CHIP_ERROR Silence(uint8_t count);
+  // Sweep the device count in the background, each step runs for stepMs. The samples are logged and
+  // kept for GetSamples.
+  CHIP_ERROR Benchmark(uint32_t intervalMs, uint32_t stepMs);
+
+  uint8_t GetSamples(const Sample **samples) const {
+    *samples = mSamples;
+    return mSampleCount;
+  }
+
+ private:
+  enum class Phase : uint8_t { IDLE, RUNNING, SETTLE, MEASURE, DRAIN };
+
+  BridgeSimulation();
+
+  static void StepWorkEntry(struct k_work *work);
+  void Step();
+  uint8_t FreeEndpoints() const;
+  void AddDevices(uint8_t count);
+  void RemoveDevices();
+  void ResetCounters();
+  void Collect(Sample &sample);
+
+  const BleMatterProfile::Profile *mProfile = nullptr;
+  Phase mPhase = Phase::IDLE;
+  uint32_t mIntervalMs = 0;
+  uint32_t mStepMs = 0;
+  uint8_t mMaxCount = 0;
+  uint16_t mNextId = 0;
+
+  MatterDeviceSim *mDevices[kMaxDevices] = {};
+  uint8_t mDeviceCount = 0;
+  int64_t mStartMs = 0;
+  BridgeManager::ReportQueueStats mReportBaseline = {};
+
+  Sample mSamples[kMaxSamples];
+  uint8_t mSampleCount = 0;
+
+  struct k_work_delayable mStepWork;
+  struct k_work_q mWorkQueue;
+};
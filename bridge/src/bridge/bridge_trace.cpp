@@ -0,0 +1,43 @@
+#include "bridge_trace.h"
+
+#include <zephyr/spinlock.h>
+
+static BridgeTrace::TraceRecord sRecords[BridgeTrace::kBufferSize];
+static uint32_t sWritten;
+static struct k_spinlock sLock;
+
+void BridgeTrace::Record(Event event, uint16_t a, uint32_t b, uint32_t c) {
+  k_spinlock_key_t key = k_spin_lock(&sLock);
+  TraceRecord &record = sRecords[sWritten & (kBufferSize - 1)];
+  record.cycles = k_cycle_get_32();
+  record.event = event;
+  record.reserved = 0;
+  record.a = a;
+  record.b = b;
+  record.c = c;
+  sWritten++;
+  k_spin_unlock(&sLock, key);
+}
+
+uint32_t BridgeTrace::GetWritten() {
+  k_spinlock_key_t key = k_spin_lock(&sLock);
+  uint32_t written = sWritten;
+  k_spin_unlock(&sLock, key);
+  return written;
+}
+
+bool BridgeTrace::Get(uint32_t sequence, TraceRecord &record) {
+  k_spinlock_key_t key = k_spin_lock(&sLock);
+  bool valid = sequence < sWritten && sWritten - sequence <= kBufferSize;
+  if (valid) {
+    record = sRecords[sequence & (kBufferSize - 1)];
+  }
+  k_spin_unlock(&sLock, key);
+  return valid;
+}
+
+void BridgeTrace::Clear() {
+  k_spinlock_key_t key = k_spin_lock(&sLock);
+  sWritten = 0;
+  k_spin_unlock(&sLock, key);
+}
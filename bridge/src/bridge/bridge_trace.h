@@ -0,0 +1,67 @@
+#pragma once
+
+#include <zephyr/kernel.h>
+
+// Binary trace of the bridge hot paths: attribute reads and writes, notifications and reports.
+// Each event is a 16 byte record of an event id and up to three integers, written into a ring
+// buffer without any formatting. "matter_bridge trace dump" prints the ring as hex and
+// scripts/bridge_trace_decode.py renders it on the host.
+//
+// BRIDGE_TRACE compiles to nothing unless CONFIG_BRIDGE_TRACE is enabled, its arguments are not
+// evaluated then.
+#ifdef CONFIG_BRIDGE_TRACE
+#define BRIDGE_TRACE(event, a, b, c)                                \
+  BridgeTrace::Record(BridgeTrace::event, static_cast<uint16_t>(a), \
+                      static_cast<uint32_t>(b), static_cast<uint32_t>(c))
+#else
+#define BRIDGE_TRACE(event, a, b, c) \
+  do {                               \
+  } while (0)
+#endif
+
+#ifdef CONFIG_BRIDGE_TRACE
+class BridgeTrace {
+ public:
+  static constexpr uint16_t kBufferSize = CONFIG_BRIDGE_TRACE_BUFFER_SIZE;
+  static_assert((kBufferSize & (kBufferSize - 1)) == 0, "Trace buffer size must be a power of 2");
+  static constexpr uint8_t kFormatVersion = 1;
+
+  // Keep in sync with EVENTS in scripts/bridge_trace_decode.py. Ids are part of the dump format,
+  // append only.
+  enum Event : uint8_t {
+    ATTRIBUTE_READ = 1,      // endpoint, cluster, attribute
+    ATTRIBUTE_WRITE,         // endpoint, cluster, attribute
+    BRIDGE_READ,             // index, cluster, attribute
+    BRIDGE_WRITE,            // index, cluster, attribute
+    DEVICE_READ,             // endpoint, cluster, attribute
+    DEVICE_READ_BASIC,       // endpoint, -, attribute
+    DEVICE_READ_DESCRIPTOR,  // endpoint, -, attribute
+    DEVICE_READ_MISS,        // endpoint, cluster, attribute
+    DEVICE_WRITE,            // endpoint, cluster, attribute
+    NOTIFICATION,            // value handle, length, -
+    NOTIFICATION_ROUTED,     // endpoint, cluster, attribute
+    GATT_READ,               // handle, -, -
+    REPORT,                  // endpoint, cluster, attribute
+    NOTIFICATION_BATCH,      // endpoint, notifications drained, -
+    GATT_WRITE,              // handle, length, without response
+    LIVENESS_EXPIRED,        // endpoint, silent ms, timeout ms
+  };
+
+  struct TraceRecord {
+    uint32_t cycles;
+    uint8_t event;
+    uint8_t reserved;
+    uint16_t a;
+    uint32_t b;
+    uint32_t c;
+  } __packed;
+  static_assert(sizeof(TraceRecord) == 16, "Trace records are 16 bytes");
+
+  static void Record(Event event, uint16_t a, uint32_t b, uint32_t c);
+  // Number of records written since the last Clear, including overwritten ones.
+  static uint32_t GetWritten();
+  // Copy record number sequence. Fails once it was overwritten.
+  static bool Get(uint32_t sequence, TraceRecord &record);
+  static void Clear();
+};
+#endif
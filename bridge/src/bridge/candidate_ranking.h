@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <zephyr/bluetooth/addr.h>
+
+// Choice between several advertisers matching the same scan request. Their advertising reports
+// are collected for a short window, then they are connected to best first: the strongest signal
+// holds the most stable and fastest link, a bonded peer reconnects without pairing. Plain
+// functions on plain data without any Bluetooth calls, so recorded reports can be replayed on the
+// host.
+namespace CandidateRanking {
+
+// A bonded peer wins against an unbonded advertiser unless that one is this much stronger.
+constexpr int16_t kBondedBonusDb = 10;
+// Reported by controllers that cannot measure the RSSI.
+constexpr int8_t kRssiUnknown = 127;
+constexpr int8_t kRssiMin = -127;
+
+struct Candidate {
+  bt_addr_le_t addr;
+  int32_t rssiSum;
+  uint8_t reports;
+  bool bonded;
+  // Order of the first report, ties go to the earlier advertiser.
+  uint8_t order;
+};
+
+inline int16_t MeanRssi(const Candidate &candidate) {
+  return candidate.reports ? candidate.rssiSum / candidate.reports : kRssiMin;
+}
+
+inline int16_t Score(const Candidate &candidate) {
+  return MeanRssi(candidate) + (candidate.bonded ? kBondedBonusDb : 0);
+}
+
+// Whether a is to be connected before b.
+inline bool IsBetter(const Candidate &a, const Candidate &b) {
+  if (Score(a) != Score(b)) {
+    return Score(a) > Score(b);
+  }
+  // More reports in the same time, a steadier link.
+  if (a.reports != b.reports) {
+    return a.reports > b.reports;
+  }
+  return a.order < b.order;
+}
+
+// Add an advertising report to the candidates. A new advertiser replaces the worst candidate if
+// the list is full and it is better. Returns false if the report was not taken.
+inline bool AddReport(Candidate *candidates, uint8_t &count, uint8_t maxCount,
+                      const bt_addr_le_t *addr, int8_t rssi, bool bonded) {
+  if (rssi == kRssiUnknown) {
+    rssi = kRssiMin;
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    if (bt_addr_le_eq(&candidates[i].addr, addr)) {
+      candidates[i].rssiSum += rssi;
+      candidates[i].reports++;
+      return true;
+    }
+  }
+
+  Candidate candidate = {};
+  bt_addr_le_copy(&candidate.addr, addr);
+  candidate.rssiSum = rssi;
+  candidate.reports = 1;
+  candidate.bonded = bonded;
+  candidate.order = UINT8_MAX;
+
+  uint8_t slot = count;
+  if (count == maxCount) {
+    slot = 0;
+    for (uint8_t i = 1; i < count; i++) {
+      if (IsBetter(candidates[slot], candidates[i])) {
+        slot = i;
+      }
+    }
+    if (!IsBetter(candidate, candidates[slot])) {
+      return false;
+    }
+  } else {
+    count++;
+  }
+  // After all candidates there are, ties with them go to them.
+  uint8_t order = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    if (i != slot && candidates[i].order >= order) {
+      order = candidates[i].order < UINT8_MAX ? candidates[i].order + 1 : UINT8_MAX;
+    }
+  }
+  candidate.order = order;
+  candidates[slot] = candidate;
+  return true;
+}
+
+// Sort the candidates best first. Insertion sort, there are only a handful.
+inline void Rank(Candidate *candidates, uint8_t count) {
+  for (uint8_t i = 1; i < count; i++) {
+    Candidate candidate = candidates[i];
+    uint8_t j = i;
+    for (; j > 0 && IsBetter(candidate, candidates[j - 1]); j--) {
+      candidates[j] = candidates[j - 1];
+    }
+    candidates[j] = candidate;
+  }
+}
+
+}  // namespace CandidateRanking
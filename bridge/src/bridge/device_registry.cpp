@@ -0,0 +1,216 @@
+#include "device_registry.h"
+
+#include <platform/PlatformManager.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+
+#include <cstring>
+
+#include "bridge_manager.h"
+
+LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
+
+#define REGISTRY_SUBTREE "bridge/dev"
+
+// Record removed on the CHIP thread, deleted from the system workqueue after any write of it.
+struct RegistryDelete {
+  struct k_work work;
+  char key[SETTINGS_MAX_NAME_LEN + 1];
+};
+
+DeviceRegistry::DeviceRegistry() {
+  k_work_init_delayable(&mStoreWork, StoreWorkEntry);
+  k_work_init(&mWrite.work, WriteWorkEntry);
+  atomic_clear(&mWrite.busy);
+}
+
+void DeviceRegistry::Key(const char *name, char *key, size_t size) {
+  snprintk(key, size, REGISTRY_SUBTREE "/%s", name);
+}
+
+void DeviceRegistry::Load() {
+  mRecordCount = 0;
+
+  settings_load_subtree_direct(
+      REGISTRY_SUBTREE,
+      [](const char *key, size_t len, settings_read_cb read_cb, void *cb_arg, void *param) -> int {
+        auto *registry = reinterpret_cast<DeviceRegistry *>(param);
+        StoredHeader header;
+        if (!key || registry->mRecordCount >= kMaxRecords || len < sizeof(header)) {
+          return 0;
+        }
+        ssize_t read = read_cb(cb_arg, &header, sizeof(header));
+        if (read < (ssize_t)sizeof(header) || header.version != kStoredVersion) {
+          return 0;
+        }
+        Record &record = registry->mRecords[registry->mRecordCount++];
+        strncpy(record.name, key, sizeof(record.name) - 1);
+        record.name[sizeof(record.name) - 1] = '\0';
+        record.endpointId = header.endpointId;
+        return 0;
+      },
+      this);
+
+  LOG_INF("DeviceRegistry: %d device(s) stored", mRecordCount);
+  for (uint8_t i = 0; i < mRecordCount; i++) {
+    LOG_INF("  %s on endpoint %d", mRecords[i].name, mRecords[i].endpointId);
+  }
+}
+
+DeviceRegistry::Record *DeviceRegistry::FindRecord(const char *name) {
+  for (uint8_t i = 0; i < mRecordCount; i++) {
+    if (strncmp(mRecords[i].name, name, sizeof(mRecords[i].name)) == 0) {
+      return &mRecords[i];
+    }
+  }
+  return nullptr;
+}
+
+chip::EndpointId DeviceRegistry::FindEndpointId(const char *name) const {
+  for (uint8_t i = 0; i < mRecordCount; i++) {
+    if (strncmp(mRecords[i].name, name, sizeof(mRecords[i].name)) == 0) {
+      return mRecords[i].endpointId;
+    }
+  }
+  return chip::kInvalidEndpointId;
+}
+
+bool DeviceRegistry::IsEndpointIdTaken(chip::EndpointId endpointId) const {
+  for (uint8_t i = 0; i < mRecordCount; i++) {
+    if (mRecords[i].endpointId == endpointId) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint8_t DeviceRegistry::RestoreAttributes(MatterDevice *dev) {
+  char key[SETTINGS_MAX_NAME_LEN + 1];
+  Key(dev->GetName(), key, sizeof(key));
+
+  struct RecordLoad {
+    uint8_t *buffer;
+    size_t size;
+    ssize_t length;
+  } load = {mBuffer, sizeof(mBuffer), -1};
+
+  settings_load_subtree_direct(
+      key,
+      [](const char *key, size_t len, settings_read_cb read_cb, void *cb_arg, void *param) -> int {
+        auto *load = reinterpret_cast<RecordLoad *>(param);
+        if (len > load->size || len < sizeof(StoredHeader)) {
+          return 0;
+        }
+        load->length = read_cb(cb_arg, load->buffer, len);
+        return 0;
+      },
+      &load);
+
+  const auto *header = reinterpret_cast<const StoredHeader *>(mBuffer);
+  VerifyOrReturnValue(load.length >= (ssize_t)sizeof(StoredHeader), 0);
+  VerifyOrReturnValue(header->version == kStoredVersion, 0);
+
+  uint8_t restored = dev->RestoreAttributes(mBuffer + sizeof(StoredHeader),
+                                            load.length - sizeof(StoredHeader));
+  LOG_INF("DeviceRegistry: restored %d value(s) of %s", restored, dev->GetName());
+  return restored;
+}
+
+void DeviceRegistry::ScheduleStore(uint8_t index) {
+  VerifyOrReturn(index < kMaxRecords);
+  atomic_set_bit(mDirty, index);
+  // Does not push back a store that is already scheduled, values are written at least every
+  // kStoreDelayMs while they keep changing.
+  k_work_schedule(&mStoreWork, K_MSEC(kStoreDelayMs));
+}
+
+void DeviceRegistry::StoreWorkEntry(struct k_work *work) {
+  chip::DeviceLayer::PlatformMgr().ScheduleWork(
+      [](intptr_t context) { DeviceRegistry::Instance().StoreDirty(); },
+      reinterpret_cast<intptr_t>(nullptr));
+}
+
+void DeviceRegistry::StoreDirty() {
+  // The write in flight picks up the remaining devices once it is done.
+  VerifyOrReturn(!atomic_get(&mWrite.busy));
+
+  for (uint8_t i = 0; i < kMaxRecords; i++) {
+    if (!atomic_test_and_clear_bit(mDirty, i)) {
+      continue;
+    }
+    MatterDevice *dev = BridgeManager::Instance().GetDevice(i);
+    if (dev && dev->IsPersistent()) {
+      Snapshot(dev);
+      // Flash writes do not belong into the CHIP thread.
+      atomic_set(&mWrite.busy, 1);
+      k_work_submit(&mWrite.work);
+      return;
+    }
+  }
+}
+
+void DeviceRegistry::Snapshot(MatterDevice *dev) {
+  Key(dev->GetName(), mWrite.key, sizeof(mWrite.key));
+
+  auto *header = reinterpret_cast<StoredHeader *>(mWrite.buffer);
+  header->version = kStoredVersion;
+  header->endpointId = dev->GetEndpointId();
+  // Taken under the lock of the attribute cache.
+  mWrite.length = sizeof(StoredHeader) +
+                  dev->SnapshotAttributes(mWrite.buffer + sizeof(StoredHeader),
+                                          sizeof(mWrite.buffer) - sizeof(StoredHeader));
+
+  // The endpoint id belongs to the device from now on, whether or not the write succeeds.
+  Record *record = FindRecord(dev->GetName());
+  if (!record && mRecordCount < kMaxRecords) {
+    record = &mRecords[mRecordCount++];
+    strncpy(record->name, dev->GetName(), sizeof(record->name) - 1);
+    record->name[sizeof(record->name) - 1] = '\0';
+  }
+  if (record) {
+    record->endpointId = header->endpointId;
+  }
+}
+
+void DeviceRegistry::WriteWorkEntry(struct k_work *work) {
+  DeviceRegistry &registry = Instance();
+  const auto *header = reinterpret_cast<const StoredHeader *>(registry.mWrite.buffer);
+  uint16_t length = registry.mWrite.length - sizeof(StoredHeader);
+
+  int err = settings_save_one(registry.mWrite.key, registry.mWrite.buffer, registry.mWrite.length);
+  LOG_INF("DeviceRegistry: stored %s on endpoint %d, %d bytes of values (err %d)",
+          registry.mWrite.key, header->endpointId, length, err);
+  atomic_clear(&registry.mWrite.busy);
+
+  // Devices that got dirty meanwhile were left for this write to finish.
+  for (uint8_t i = 0; i < kMaxRecords; i++) {
+    if (atomic_test_bit(registry.mDirty, i)) {
+      k_work_schedule(&registry.mStoreWork, K_NO_WAIT);
+      return;
+    }
+  }
+}
+
+void DeviceRegistry::Remove(const char *name) {
+  RegistryDelete *del = chip::Platform::New<RegistryDelete>();
+  if (del) {
+    Key(name, del->key, sizeof(del->key));
+    k_work_init(&del->work, DeleteWorkEntry);
+    k_work_submit(&del->work);
+  } else {
+    LOG_ERR("DeviceRegistry: No memory, %s stays stored", name);
+  }
+
+  Record *record = FindRecord(name);
+  if (record) {
+    *record = mRecords[--mRecordCount];
+  }
+  LOG_INF("DeviceRegistry: removed %s", name);
+}
+
+void DeviceRegistry::DeleteWorkEntry(struct k_work *work) {
+  RegistryDelete *del = CONTAINER_OF(work, RegistryDelete, work);
+  int err = settings_delete(del->key);
+  LOG_INF("DeviceRegistry: deleted %s (err %d)", del->key, err);
+  chip::Platform::Delete(del);
+}
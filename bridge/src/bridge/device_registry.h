@@ -0,0 +1,80 @@
+#pragma once
+
+#include <lib/core/DataModelTypes.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/atomic.h>
+
+#include "attribute_cache.h"
+#include "matter_device.h"
+
+// Persistent record of the bridged devices: the endpoint id each device was registered with and
+// the last known attribute values. Records are stored in settings under bridge/dev/<name>, device
+// names must be unique. The records let the bridge bring the same endpoints back at boot and answer
+// reads from the cache before the devices themselves are reachable again.
+class DeviceRegistry {
+ public:
+  static constexpr uint8_t kMaxRecords = CONFIG_BRIDGE_MAX_DYNAMIC_ENDPOINTS_NUMBER;
+  static constexpr uint32_t kStoreDelayMs = CONFIG_BRIDGE_REGISTRY_STORE_DELAY_MS;
+
+  static DeviceRegistry &Instance() {
+    static DeviceRegistry sInstance;
+    return sInstance;
+  }
+
+  // Load the endpoint ids of all stored devices. Called once before the first device is added.
+  void Load();
+
+  // Endpoint id the device was registered with before, chip::kInvalidEndpointId if unknown.
+  chip::EndpointId FindEndpointId(const char *name) const;
+  bool IsEndpointIdTaken(chip::EndpointId endpointId) const;
+
+  // Put the stored attribute values back into the device's cache. Returns the number of values.
+  uint8_t RestoreAttributes(MatterDevice *dev);
+
+  // Store the endpoint id and attribute values of the device at dynamic endpoint index. Safe to
+  // call from any thread. Stores are coalesced for kStoreDelayMs to spare the flash. The values
+  // are snapshot on the CHIP thread and written from the system workqueue, one device at a time.
+  void ScheduleStore(uint8_t index);
+  void Remove(const char *name);
+
+ private:
+  struct Record {
+    char name[NODE_LABEL_SIZE];
+    chip::EndpointId endpointId;
+  };
+
+  // Stored value layout, followed by an AttributeCache snapshot.
+  struct StoredHeader {
+    uint8_t version;
+    chip::EndpointId endpointId;
+  } __packed;
+  static constexpr uint8_t kStoredVersion = 1;
+
+  DeviceRegistry();
+
+  static void Key(const char *name, char *key, size_t size);
+  static void StoreWorkEntry(struct k_work *work);
+  static void WriteWorkEntry(struct k_work *work);
+  static void DeleteWorkEntry(struct k_work *work);
+  void StoreDirty();
+  void Snapshot(MatterDevice *dev);
+  Record *FindRecord(const char *name);
+
+  Record mRecords[kMaxRecords];
+  uint8_t mRecordCount = 0;
+
+  ATOMIC_DEFINE(mDirty, kMaxRecords);
+  struct k_work_delayable mStoreWork;
+  // Snapshot handed from the CHIP thread to the system workqueue. Filled while not busy, the write
+  // clears busy once it is done.
+  struct {
+    struct k_work work;
+    atomic_t busy;
+    char key[SETTINGS_MAX_NAME_LEN + 1];
+    uint16_t length;
+    uint8_t buffer[sizeof(StoredHeader) + AttributeCache::kMaxSnapshotSize];
+  } mWrite;
+  // Only used on the CHIP thread.
+  uint8_t mBuffer[sizeof(StoredHeader) + AttributeCache::kMaxSnapshotSize];
+};
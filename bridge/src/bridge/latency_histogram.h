@@ -0,0 +1,81 @@
+#pragma once
+
+#include <lib/support/CodeUtils.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+// Latency histogram with fixed log2 buckets. Bucket i counts latencies in [2^i, 2^(i+1)) us,
+// bucket 0 also counts 0 us and the last bucket everything above. Recording takes a few atomic
+// operations and is safe from any thread, no locking and no allocation.
+class LatencyHistogram {
+ public:
+  static constexpr uint8_t kBuckets = 24;
+
+  // Latency between two k_cycle_get_32 timestamps. An end before the start counts as 0 us.
+  static uint32_t CyclesToUs(uint32_t startCyc, uint32_t endCyc) {
+    int32_t delta = (int32_t)(endCyc - startCyc);
+    return delta > 0 ? k_cyc_to_us_floor32(delta) : 0;
+  }
+
+  void Record(uint32_t us) {
+    uint8_t bucket = us ? MIN(31 - __builtin_clz(us), kBuckets - 1) : 0;
+    atomic_inc(&mBuckets[bucket]);
+
+    atomic_val_t max = atomic_get(&mMaxUs);
+    while ((atomic_val_t)us > max && !atomic_cas(&mMaxUs, max, us)) {
+      max = atomic_get(&mMaxUs);
+    }
+  }
+
+  void RecordCycles(uint32_t startCyc, uint32_t endCyc) { Record(CyclesToUs(startCyc, endCyc)); }
+
+  uint32_t GetBucket(uint8_t bucket) const { return atomic_get(&mBuckets[bucket]); }
+  uint32_t GetMaxUs() const { return atomic_get(&mMaxUs); }
+
+  uint32_t GetCount() const {
+    uint32_t count = 0;
+    for (uint8_t i = 0; i < kBuckets; i++) {
+      count += GetBucket(i);
+    }
+    return count;
+  }
+
+  // Upper bound of the bucket the given percentile falls into, in us. 0 if nothing was recorded.
+  uint32_t GetPercentileUs(uint8_t percent) const {
+    uint32_t count = GetCount();
+    VerifyOrReturnValue(count > 0, 0);
+
+    uint32_t rank = (count * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < kBuckets - 1; i++) {
+      seen += GetBucket(i);
+      if (seen >= rank) {
+        return BIT(i + 1) - 1;
+      }
+    }
+    return GetMaxUs();
+  }
+
+  // Add the values recorded by another histogram, e.g. to combine several devices.
+  void Merge(const LatencyHistogram &other) {
+    for (uint8_t i = 0; i < kBuckets; i++) {
+      atomic_add(&mBuckets[i], other.GetBucket(i));
+    }
+    atomic_val_t max = atomic_get(&mMaxUs);
+    while ((atomic_val_t)other.GetMaxUs() > max && !atomic_cas(&mMaxUs, max, other.GetMaxUs())) {
+      max = atomic_get(&mMaxUs);
+    }
+  }
+
+  void Reset() {
+    for (uint8_t i = 0; i < kBuckets; i++) {
+      atomic_clear(&mBuckets[i]);
+    }
+    atomic_clear(&mMaxUs);
+  }
+
+ private:
+  atomic_t mBuckets[kBuckets] = {};
+  atomic_t mMaxUs = ATOMIC_INIT(0);
+};
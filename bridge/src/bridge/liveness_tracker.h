@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdint.h>
+#include <zephyr/sys/util.h>
+
+// Supervision of a device that sends values at a steady cadence, e.g. notifications of a
+// connected peripheral or advertisements of a broadcasting sensor. The device counts as gone once
+// it was silent for a number of its intervals, independent of the link layer, which keeps a
+// connection up for the whole supervision timeout and does not notice a peripheral that stays
+// connected but stopped sending.
+//
+// The interval starts at the profile's expected one and follows the measured intervals. The
+// timeout is bounded by the profile, so a device that falls silent is detected at most maxTimeoutMs
+// plus the check period after its last value. Times are passed in, nothing here reads a clock.
+class LivenessTracker {
+ public:
+  struct Profile {
+    // Interval assumed until one was measured, 0 if unknown.
+    uint32_t expectedIntervalMs;
+    // Intervals without any value after which the device counts as gone.
+    uint8_t missedIntervals;
+    uint32_t minTimeoutMs;
+    uint32_t maxTimeoutMs;
+  };
+
+  struct Stats {
+    uint32_t expirations;
+    // Time from the last value until the silence was detected.
+    uint32_t lastDetectionMs;
+    uint32_t maxDetectionMs;
+  };
+
+  void Start(const Profile &profile, int64_t nowMs) {
+    mProfile = profile;
+    mIntervalMs = profile.expectedIntervalMs;
+    mLastSeenMs = nowMs;
+    mMeasured = false;
+    mActive = true;
+    mExpired = false;
+  }
+
+  void Stop() {
+    mActive = false;
+    mExpired = false;
+  }
+
+  // Note a value of the device. Returns true if the device had been detected as gone before.
+  bool Seen(int64_t nowMs) {
+    if (!mActive) {
+      return false;
+    }
+    // The first value only starts the measurement, a silence is no interval of the cadence.
+    if (mMeasured && !mExpired) {
+      uint32_t intervalMs = MIN(nowMs - mLastSeenMs, mProfile.maxTimeoutMs);
+      mIntervalMs = mIntervalMs ? (7 * mIntervalMs + intervalMs) / 8 : intervalMs;
+    }
+    mMeasured = true;
+    mLastSeenMs = nowMs;
+
+    bool wasExpired = mExpired;
+    mExpired = false;
+    return wasExpired;
+  }
+
+  // Returns true once per silence, when the device has been silent for the timeout.
+  bool Check(int64_t nowMs) {
+    if (!mActive || mExpired || nowMs - mLastSeenMs < GetTimeoutMs()) {
+      return false;
+    }
+    mExpired = true;
+    mStats.expirations++;
+    mStats.lastDetectionMs = nowMs - mLastSeenMs;
+    mStats.maxDetectionMs = MAX(mStats.maxDetectionMs, mStats.lastDetectionMs);
+    return true;
+  }
+
+  uint32_t GetTimeoutMs() const {
+    if (mIntervalMs == 0) {
+      return mProfile.maxTimeoutMs;
+    }
+    uint64_t timeoutMs = (uint64_t)mIntervalMs * mProfile.missedIntervals;
+    return CLAMP(timeoutMs, mProfile.minTimeoutMs, mProfile.maxTimeoutMs);
+  }
+
+  uint32_t GetIntervalMs() const { return mIntervalMs; }
+  bool IsActive() const { return mActive; }
+  bool IsExpired() const { return mExpired; }
+  Stats GetStats() const { return mStats; }
+  void ResetStats() { mStats = {}; }
+
+ private:
+  Profile mProfile = {};
+  uint32_t mIntervalMs = 0;
+  int64_t mLastSeenMs = 0;
+  bool mMeasured = false;
+  bool mActive = false;
+  bool mExpired = false;
+  Stats mStats = {};
+};
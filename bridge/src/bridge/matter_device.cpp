@@ -5,10 +5,13 @@
 #include <app/util/af-types.h>
 #include <lib/core/DataModelTypes.h>
 #include <lib/support/ZclString.h>
+#include <platform/LockTracker.h>
 #include <platform/PlatformManager.h>
 #include <zephyr/logging/log.h>
 
 #include "bridge_manager.h"
+#include "bridge_trace.h"
+#include "device_registry.h"
 LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
 
 #define ZCL_CLUSTER_REVISION (1u)
@@ -25,7 +28,7 @@ using namespace ::chip::app::Clusters;
 CHIP_ERROR MatterDevice::HandleReadBridgedDeviceBasicInformation(chip::AttributeId attributeId,
                                                                  uint8_t *buffer,
                                                                  uint16_t maxReadLength) {
-  LOG_INF("MatterDevice::HandleReadBridgedDeviceBasicInformation with attributeId %d", attributeId);
+  BRIDGE_TRACE(DEVICE_READ_BASIC, GetEndpointId(), BridgedDeviceBasicInformation::Id, attributeId);
   switch (attributeId) {
     case BridgedDeviceBasicInformation::Attributes::Reachable::Id: {
       *buffer = GetIsReachable() ? 1 : 0;
@@ -55,7 +58,7 @@ CHIP_ERROR MatterDevice::HandleReadBridgedDeviceBasicInformation(chip::Attribute
 
 CHIP_ERROR MatterDevice::HandleReadDescriptor(chip::AttributeId attributeId, uint8_t *buffer,
                                               uint16_t maxReadLength) {
-  LOG_INF("MatterDevice::HandleReadDescriptor with attributeId %d", attributeId);
+  BRIDGE_TRACE(DEVICE_READ_DESCRIPTOR, GetEndpointId(), Descriptor::Id, attributeId);
   switch (attributeId) {
     case Descriptor::Attributes::ClusterRevision::Id: {
       uint16_t clusterRevision = ZCL_CLUSTER_REVISION;
@@ -76,7 +79,7 @@ CHIP_ERROR MatterDevice::HandleReadDescriptor(chip::AttributeId attributeId, uin
 
 CHIP_ERROR MatterDevice::HandleRead(chip::ClusterId clusterId, chip::AttributeId attributeId,
                                     uint8_t *buffer, uint16_t maxReadLength) {
-  LOG_INF("MatterDevice::HandleRead with clusterId %d, attributeId %d", clusterId, attributeId);
+  BRIDGE_TRACE(DEVICE_READ, GetEndpointId(), clusterId, attributeId);
   switch (attributeId) {
     case LevelControl::Attributes::ClusterRevision::Id: {
       uint16_t clusterRevision = ZCL_CLUSTER_REVISION;
@@ -89,17 +92,14 @@ CHIP_ERROR MatterDevice::HandleRead(chip::ClusterId clusterId, chip::AttributeId
       break;
     }
     default: {
-      LOG_INF("MatterDevice::HandleRead forward to device");
-      if (attributeCache.contains(attributeId)) {
-        memcpy(buffer, &attributeCache[attributeId], 2);
-        LOG_INF("MatterDevice::HandleRead Read OK");
-      } else {
-        LOG_ERR("MatterDevice::HandleRead Read No value cached.");
-        // Temporarily workaround to return CHIP_NO_ERROR
-        memset(buffer, 0, maxReadLength);
-        // return CHIP_ERROR_INTERNAL;
+      CHIP_ERROR err = mAttributeCache.Read(clusterId, attributeId, buffer, maxReadLength);
+      if (err == CHIP_ERROR_NOT_FOUND) {
+        BRIDGE_TRACE(DEVICE_READ_MISS, GetEndpointId(), clusterId, attributeId);
+        RefreshAttribute(clusterId, attributeId);
+      } else if (err != CHIP_NO_ERROR) {
+        LOG_ERR("MatterDevice::HandleRead failed (%" CHIP_ERROR_FORMAT ")", err.Format());
       }
-      break;
+      return err;
     }
   }
   return CHIP_NO_ERROR;
@@ -118,20 +118,150 @@ CHIP_ERROR MatterDevice::HandleRead(chip::ClusterId clusterId, chip::AttributeId
 */
 
 CHIP_ERROR MatterDevice::HandleWrite(chip::ClusterId clusterId, chip::AttributeId attributeId,
-                                     uint8_t *buffer) {
-  LOG_INF("MatterDevice::HandleWrite with clusterId %d, attributeId %d", clusterId, attributeId);
-  return CHIP_ERROR_UNSUPPORTED_CHIP_FEATURE;
+                                     uint8_t *buffer, uint16_t length) {
+  BRIDGE_TRACE(DEVICE_WRITE, GetEndpointId(), clusterId, attributeId);
+  CHIP_ERROR err = WriteAttribute(clusterId, attributeId, buffer, length);
+  if (err != CHIP_NO_ERROR && err != CHIP_ERROR_UNSUPPORTED_CHIP_FEATURE) {
+    LOG_ERR("MatterDevice::HandleWrite failed (%" CHIP_ERROR_FORMAT ")", err.Format());
+  }
+  return err;
+}
+
+void MatterDevice::UpdateAttribute(chip::ClusterId clusterId, chip::AttributeId attributeId,
+                                   const void *data, uint16_t length, uint32_t receivedCyc) {
+  bool changed = mAttributeCache.Set(clusterId, attributeId, data, length);
+  uint32_t cachedCyc = k_cycle_get_32();
+  mLatency[kLatencyCache].RecordCycles(receivedCyc, cachedCyc);
+  if (!changed) {
+    BridgeManager::Instance().NoteUnchangedAttribute();
+    return;
+  }
+
+  BridgeManager::Instance().ReportAttributeChange(GetEndpointId(), clusterId, attributeId,
+                                                  receivedCyc, cachedCyc);
+  ScheduleStore();
+}
+
+void MatterDevice::UpdateAttributes(const AttributeCache::Value *values, uint8_t count,
+                                    uint32_t receivedCyc) {
+  bool changed[AttributeCache::kMaxEntries];
+  count = MIN(count, ARRAY_SIZE(changed));
+  if (mAttributeCache.SetMultiple(values, count, changed) > 0) {
+    ScheduleStore();
+  }
+  uint32_t cachedCyc = k_cycle_get_32();
+  mLatency[kLatencyCache].RecordCycles(receivedCyc, cachedCyc);
+
+  for (uint8_t i = 0; i < count; i++) {
+    if (changed[i]) {
+      BridgeManager::Instance().ReportAttributeChange(GetEndpointId(), values[i].clusterId,
+                                                      values[i].attributeId, receivedCyc,
+                                                      cachedCyc);
+    } else {
+      BridgeManager::Instance().NoteUnchangedAttribute();
+    }
+  }
+}
+
+/****************************
+ * Notification hand-off
+ ****************************/
+static void DrainNotificationsEntry(intptr_t context) {
+  // The device may have been removed since the drain was scheduled.
+  MatterDevice *dev = BridgeManager::Instance().GetDevice(static_cast<uint16_t>(context));
+  if (dev) {
+    dev->DrainNotifications();
+  }
+}
+
+bool MatterDevice::PostNotification(uint16_t valueHandle, const void *data, uint16_t length) {
+  bool queued = mNotificationRing.Push(valueHandle, data, length, k_cycle_get_32());
+  if (queued && atomic_cas(&mNotificationDrainScheduled, 0, 1)) {
+    int index = BridgeManager::Instance().FindIndex(this);
+    if (index < 0) {
+      // Not on an endpoint yet, the next notification tries again.
+      atomic_clear(&mNotificationDrainScheduled);
+      return queued;
+    }
+    chip::DeviceLayer::PlatformMgr().ScheduleWork(DrainNotificationsEntry, index);
+  }
+  return queued;
+}
+
+void MatterDevice::DrainNotifications() {
+  // Values after a silence make the device reachable again, before they are cached and reported.
+  if (!mNotificationRing.IsEmpty() && mLiveness.Seen(k_uptime_get())) {
+    LOG_INF("%s: Sending again", GetName());
+    SetIsReachable(true);
+  }
+
+  mNotificationRing.NoteBatch();
+  uint16_t count = 0;
+  do {
+    const NotificationRing::Record *record;
+    while ((record = mNotificationRing.Peek()) != nullptr) {
+      HandleNotification(record->valueHandle, record->data, record->length, record->receivedCyc);
+      mNotificationRing.Pop();
+      count++;
+    }
+    atomic_clear(&mNotificationDrainScheduled);
+    // Notifications posted after the last Peek saw the drain still scheduled, take them along.
+  } while (!mNotificationRing.IsEmpty() && atomic_cas(&mNotificationDrainScheduled, 0, 1));
+  BRIDGE_TRACE(NOTIFICATION_BATCH, GetEndpointId(), count, 0);
+}
+
+/****************************
+ * Liveness
+ ****************************/
+void MatterDevice::SuperviseLiveness(const LivenessTracker::Profile &profile) {
+  assertChipStackLockedByCurrentThread();
+  mLiveness.Start(profile, k_uptime_get());
+}
+
+void MatterDevice::SuperviseLiveness(uint32_t expectedIntervalMs) {
+  SuperviseLiveness({expectedIntervalMs, CONFIG_BRIDGE_LIVENESS_MISSED_INTERVALS,
+                     CONFIG_BRIDGE_LIVENESS_MIN_TIMEOUT_MS, CONFIG_BRIDGE_LIVENESS_MAX_TIMEOUT_MS});
+}
+
+void MatterDevice::StopLivenessSupervision() {
+  assertChipStackLockedByCurrentThread();
+  mLiveness.Stop();
+}
+
+void MatterDevice::CheckLiveness(int64_t nowMs) {
+  assertChipStackLockedByCurrentThread();
+  if (mLiveness.Check(nowMs)) {
+    LivenessTracker::Stats stats = mLiveness.GetStats();
+    LOG_WRN("%s: Silent for %u ms, timeout %u ms", GetName(), stats.lastDetectionMs,
+            mLiveness.GetTimeoutMs());
+    BRIDGE_TRACE(LIVENESS_EXPIRED, GetEndpointId(), stats.lastDetectionMs,
+                 mLiveness.GetTimeoutMs());
+    LivenessExpired();
+  }
+}
+
+uint8_t MatterDevice::RestoreAttributes(const uint8_t *buffer, uint16_t length) {
+  uint8_t restored = mAttributeCache.Restore(buffer, length);
+  if (restored > 0) {
+    mIsReachable = true;
+    mIsStale = true;
+  }
+  return restored;
+}
+
+void MatterDevice::ScheduleStore() {
+  int index = BridgeManager::Instance().FindIndex(this);
+  if (index >= 0) {
+    DeviceRegistry::Instance().ScheduleStore(index);
+  }
 }
 
 void MatterDevice::SetIsReachable(bool isReachable) {
   mIsReachable = isReachable;
-  auto path = chip::Platform::New<chip::app::ConcreteAttributePath>(
+  // Either the device is back and sends fresh values, or it is gone. The restored values are no
+  // longer presented as current in both cases.
+  mIsStale = false;
+  BridgeManager::Instance().ReportAttributeChange(
       GetEndpointId(), BridgedDeviceBasicInformation::Id,
       BridgedDeviceBasicInformation::Attributes::Reachable::Id);
-  chip::DeviceLayer::PlatformMgr().ScheduleWork(
-      [](intptr_t context) {
-        auto path = reinterpret_cast<chip::app::ConcreteAttributePath *>(context);
-        BridgeManager::Instance().HandleUpdate(path);
-      },
-      reinterpret_cast<intptr_t>(path));
 }
@@ -5,13 +5,45 @@
 #include <lib/support/CHIPMem.h>
 #include <zephyr/kernel.h>
 
-#include <map>
+#include "attribute_cache.h"
+#include "latency_histogram.h"
+#include "liveness_tracker.h"
+#include "notification_ring.h"
 
 #define NODE_LABEL_SIZE 32
 
+// Readiness signals of the bridge start, see BridgeManager::SetReady. A device is started once all
+// signals it requires are set.
+enum BridgeReadySignal : uint8_t {
+  kBridgeBtReady = BIT(0),
+  kBridgeNetworkUp = BIT(1),
+  kBridgeTimeSynced = BIT(2),
+  kBridgeStorageMounted = BIT(3),
+};
+
 class MatterDevice {
  public:
+  // Stages a device value passes on its way into a Matter report, and the way of a written value
+  // out to the device.
+  enum LatencyStage : uint8_t {
+    kLatencyCache,     // value received -> cached, notifications pass the notification ring
+    kLatencyCoalesce,  // cached -> report drain handed to ScheduleWork
+    kLatencyDispatch,  // ScheduleWork -> drain running on the CHIP thread
+    kLatencyReport,    // drain running -> MatterReportingAttributeChangeCallback returned
+    kLatencyTotal,     // value received -> MatterReportingAttributeChangeCallback returned
+    kLatencyWrite,     // Matter write accepted -> written to the device
+    kLatencyStageCount
+  };
+
+  // Cadence a supervised device is assumed to send at until its interval was measured.
+  static constexpr uint32_t kLivenessExpectedIntervalMs =
+      CONFIG_BRIDGE_LIVENESS_EXPECTED_INTERVAL_MS;
+
   virtual void Init() = 0;
+  // Readiness signals Init depends on.
+  virtual uint8_t GetStartRequirements() const { return 0; }
+  // Whether the device registry keeps the device's endpoint id and values across reboots.
+  virtual bool IsPersistent() const { return true; }
 
   virtual const char *GetName() = 0;
   virtual EmberAfEndpointType *GetEndpoint() = 0;
@@ -25,17 +57,95 @@ class MatterDevice {
                                   uint16_t maxReadLength);
   CHIP_ERROR HandleRead(chip::ClusterId clusterId, chip::AttributeId attributeId, uint8_t *buffer,
                         uint16_t maxReadLength);
-  CHIP_ERROR HandleWrite(chip::ClusterId clusterId, chip::AttributeId attributeId, uint8_t *buffer);
+  CHIP_ERROR HandleWrite(chip::ClusterId clusterId, chip::AttributeId attributeId, uint8_t *buffer,
+                         uint16_t length);
+
+  // Pass an attribute write on to the device. Unsupported unless the device maps the attribute.
+  virtual CHIP_ERROR WriteAttribute(chip::ClusterId clusterId, chip::AttributeId attributeId,
+                                    const uint8_t *buffer, uint16_t length) {
+    return CHIP_ERROR_UNSUPPORTED_CHIP_FEATURE;
+  }
+
+  // Fetch the value of an attribute that has nothing cached yet in the background. The value is
+  // reported once it arrived.
+  virtual void RefreshAttribute(chip::ClusterId clusterId, chip::AttributeId attributeId) {}
+
+  // Lay out the attribute cache for the attributes of the device's endpoint.
+  CHIP_ERROR InitAttributeCache() { return mAttributeCache.Build(GetEndpoint()); }
+  // Serialize the cached values for the device registry.
+  uint16_t SnapshotAttributes(uint8_t *buffer, uint16_t size) {
+    return mAttributeCache.Snapshot(buffer, size);
+  }
+  // Serve values stored by the device registry until the device sends fresh ones. The device is
+  // reachable but stale until SetIsReachable is called.
+  uint8_t RestoreAttributes(const uint8_t *buffer, uint16_t length);
 
-  std::map<chip::AttributeId, uint16_t> attributeCache;
+  // Cache a new attribute value and report it, unless the cached value did not change.
+  // receivedCyc is the k_cycle_get_32 time the value arrived at the bridge.
+  void UpdateAttribute(chip::ClusterId clusterId, chip::AttributeId attributeId, const void *data,
+                       uint16_t length, uint32_t receivedCyc);
+  void UpdateAttribute(chip::ClusterId clusterId, chip::AttributeId attributeId, const void *data,
+                       uint16_t length) {
+    UpdateAttribute(clusterId, attributeId, data, length, k_cycle_get_32());
+  }
+  // Same for several values that belong together, e.g. the result of a batched read.
+  void UpdateAttributes(const AttributeCache::Value *values, uint8_t count, uint32_t receivedCyc);
+  void UpdateAttributes(const AttributeCache::Value *values, uint8_t count) {
+    UpdateAttributes(values, count, k_cycle_get_32());
+  }
+
+  // Hand a notification from the receiving thread to HandleNotification on the CHIP thread. Only
+  // one thread may post for a device. The first notification of a batch schedules a drain, which
+  // takes along everything posted until it runs. Returns false if the notification was dropped.
+  bool PostNotification(uint16_t valueHandle, const void *data, uint16_t length);
+  // Process a posted notification on the CHIP thread.
+  virtual void HandleNotification(uint16_t valueHandle, const uint8_t *data, uint16_t length,
+                                  uint32_t receivedCyc) {}
+  // Run HandleNotification for all posted notifications, CHIP thread only.
+  void DrainNotifications();
+  NotificationRing::Stats GetNotificationStats() const { return mNotificationRing.GetStats(); }
+  void ResetNotificationStats() { mNotificationRing.ResetStats(); }
 
   void SetEndpointId(chip::EndpointId id) { mEndpointId = id; };
   chip::EndpointId GetEndpointId() { return mEndpointId; };
 
   void SetIsReachable(bool isReachable);
   bool GetIsReachable() const { return mIsReachable; }
+  bool GetIsStale() const { return mIsStale; }
+
+  // Expect values at a steady cadence from now on, see LivenessTracker. Posted notifications count
+  // as values. CHIP thread only, like the rest of the liveness functions, asserted where stack
+  // lock tracking is enabled.
+  void SuperviseLiveness(const LivenessTracker::Profile &profile);
+  void SuperviseLiveness(uint32_t expectedIntervalMs = kLivenessExpectedIntervalMs);
+  void StopLivenessSupervision();
+  // Called periodically by the BridgeManager, runs LivenessExpired once the device fell silent.
+  void CheckLiveness(int64_t nowMs);
+  const LivenessTracker &GetLiveness() const { return mLiveness; }
+  void ResetLivenessStats() { mLiveness.ResetStats(); }
+
+  LatencyHistogram &GetLatency(LatencyStage stage) { return mLatency[stage]; }
+  void ResetLatency() {
+    for (auto &histogram : mLatency) {
+      histogram.Reset();
+    }
+  }
 
  protected:
+  // The device did not send anything for its liveness timeout. It is unreachable until the next
+  // value arrives.
+  virtual void LivenessExpired() { SetIsReachable(false); }
+
   bool mIsReachable = true;
+  bool mIsStale = false;
   chip::EndpointId mEndpointId;
+  AttributeCache mAttributeCache;
+  LatencyHistogram mLatency[kLatencyStageCount];
+
+ private:
+  void ScheduleStore();
+
+  NotificationRing mNotificationRing;
+  atomic_t mNotificationDrainScheduled = ATOMIC_INIT(0);
+  LivenessTracker mLiveness;
 };
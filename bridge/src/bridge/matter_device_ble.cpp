@@ -9,6 +9,7 @@
 #include <zephyr/bluetooth/gatt.h>
 #include <zephyr/bluetooth/uuid.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/random/rand32.h>
 
 #include "ble_device.h"
 #include "bridge_manager.h"
@@ -16,37 +17,37 @@ LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
 
 using namespace ::chip::app::Clusters;
 
-/****************************
- * Helper functions to retrieve information from mapping
- ****************************/
-std::pair<chip::ClusterId, chip::AttributeId> MatterDeviceBle::findClusterAttributeIdByUuid(
-    struct bt_uuid *uuid) {
-  auto findResult =
-      std::find_if(std::begin(mConf.matterBleMapping), std::end(mConf.matterBleMapping),
-                   [&](const std::pair<std::pair<chip::ClusterId, chip::AttributeId>,
-                                       std::pair<AttributeTypes, bt_uuid *>> &pair) {
-                     return bt_uuid_cmp(uuid, pair.second.second) == 0;
-                   });
-
-  std::pair<chip::ClusterId, chip::AttributeId> foundKey = {0, 0};
-  if (findResult != std::end(mConf.matterBleMapping)) {
-    foundKey = findResult->first;
-  }
-
-  char str[BT_UUID_STR_LEN];
-  bt_uuid_to_str(uuid, str, sizeof(str));
-  LOG_INF("Found ClusterId %d, AttributeId %d for uuid %s", foundKey.first, foundKey.second, str);
-  return foundKey;
-}
-
 /****************************
  * Free functions to map to member callbacks to workaround not being able to give member functions
  * to c-style callbacks
  ****************************/
+// Connection changes are reported on the BT RX thread or the system workqueue. They are handled
+// on the CHIP thread, which owns the routes, the liveness supervision and the BleDevice. The
+// connection is referenced until then, it may be gone from the stack in the meantime.
+struct ConnectedEvent {
+  MatterDeviceBle *dev;
+  bool connected;
+  struct bt_conn *conn;
+  const struct bt_uuid *serviceUuid;
+};
+
 static void ConnectedCallbackEntry(void *ctx, bool connected, struct bt_conn *conn,
-                                   struct bt_uuid *serviceUuid) {
-  MatterDeviceBle *dev = reinterpret_cast<MatterDeviceBle *>(ctx);
-  dev->ConnectedCallback(connected, conn, serviceUuid);
+                                   const struct bt_uuid *serviceUuid) {
+  ConnectedEvent *event = chip::Platform::New<ConnectedEvent>();
+  VerifyOrReturn(event, LOG_ERR("ConnectedCallback: No memory, connection change lost."));
+  *event = {reinterpret_cast<MatterDeviceBle *>(ctx), connected,
+            conn ? bt_conn_ref(conn) : nullptr, serviceUuid};
+
+  chip::DeviceLayer::PlatformMgr().ScheduleWork(
+      [](intptr_t context) {
+        ConnectedEvent *event = reinterpret_cast<ConnectedEvent *>(context);
+        event->dev->ConnectedCallback(event->connected, event->conn, event->serviceUuid);
+        if (event->conn) {
+          bt_conn_unref(event->conn);
+        }
+        chip::Platform::Delete(event);
+      },
+      reinterpret_cast<intptr_t>(event));
 }
 
 static void DiscoveredCallbackEntry(void *ctx) {
@@ -54,10 +55,58 @@ static void DiscoveredCallbackEntry(void *ctx) {
   dev->DiscoveredCallback();
 }
 
-static void SubscriptionCallbackEntry(void *ctx, struct bt_uuid *charUuid, const void *data,
+// READ_ONCE values read at discovery. Allocated when the batch is issued, decoded where the batch
+// completes and cached on the CHIP thread.
+struct DiscoveryRead {
+  MatterDeviceBle *dev;
+  uint32_t connectionId;
+  uint8_t count;
+  uint8_t readCount;
+  const BleMatterProfile::Characteristic *chrcs[BleDevice::kMaxBatchReads];
+  AttributeCache::Value values[BleDevice::kMaxBatchReads];
+  uint8_t buffers[BleDevice::kMaxBatchReads][GATT_READ_BUF_SIZE];
+};
+
+static void DiscoveryReadCallbackEntry(void *ctx, const BleDevice::ReadRequest *requests,
+                                       uint8_t count) {
+  DiscoveryRead *read = reinterpret_cast<DiscoveryRead *>(ctx);
+  read->readCount = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    if (requests[i].length == 0) {
+      continue;
+    }
+    const BleMatterProfile::Characteristic *chrc = read->chrcs[i];
+    uint8_t *buffer = read->buffers[read->readCount];
+    uint16_t length = chrc->codec(requests[i].buffer, requests[i].length, buffer,
+                                  GATT_READ_BUF_SIZE);
+    read->values[read->readCount++] = {chrc->clusterId, chrc->attributeId, buffer, length};
+  }
+
+  chip::DeviceLayer::PlatformMgr().ScheduleWork(
+      [](intptr_t context) {
+        DiscoveryRead *read = reinterpret_cast<DiscoveryRead *>(context);
+        read->dev->DiscoveryReadCallback(*read);
+        chip::Platform::Delete(read);
+      },
+      reinterpret_cast<intptr_t>(read));
+}
+
+static void SubscriptionCallbackEntry(void *ctx, uint16_t valueHandle, const void *data,
                                       uint16_t length) {
   MatterDeviceBle *dev = reinterpret_cast<MatterDeviceBle *>(ctx);
-  dev->SubscriptionCallback(charUuid, data, length);
+  dev->SubscriptionCallback(valueHandle, data, length);
+}
+
+static void RefreshCallbackEntry(void *ctx, const struct bt_uuid *uuid, int err,
+                                 const uint8_t *data, uint16_t length) {
+  MatterDeviceBle *dev = reinterpret_cast<MatterDeviceBle *>(ctx);
+  dev->RefreshCallback(uuid, err, data, length);
+}
+
+static void WriteCallbackEntry(void *ctx, const struct bt_uuid *uuid, int err,
+                               uint32_t queuedCyc) {
+  MatterDeviceBle *dev = reinterpret_cast<MatterDeviceBle *>(ctx);
+  dev->WriteCallback(uuid, err, queuedCyc);
 }
 
 static void RecoveryTimeoutCallbackEntry(k_timer *timer) {
@@ -74,58 +123,118 @@ static void RecoveryTimeoutCallbackEntry(k_timer *timer) {
 /****************************
  * Callback member functions
  ****************************/
-void MatterDeviceBle::SubscriptionCallback(struct bt_uuid *charUuid, const void *data,
-                                        uint16_t length) {
-  char str[BT_UUID_STR_LEN];
-  bt_uuid_to_str(charUuid, str, sizeof(str));
-  LOG_INF("SubscriptionCallback for attribute uuid %s", str);
-  LOG_HEXDUMP_DBG(data, length, "SubscriptionCallback data");
-  auto clusterAndAttributeId = findClusterAttributeIdByUuid(charUuid);
-  chip::ClusterId clusterId = clusterAndAttributeId.first;
-  chip::AttributeId attributeId = clusterAndAttributeId.second;
-  chip::EndpointId endpointId = GetEndpointId();
-
-  auto path =
-      chip::Platform::New<chip::app::ConcreteAttributePath>(endpointId, clusterId, attributeId);
-  LOG_INF("path address %p", path);
+void MatterDeviceBle::SubscriptionCallback(uint16_t valueHandle, const void *data,
+                                           uint16_t length) {
   VerifyOrReturn(data, LOG_ERR("SubscriptionCallback: No data."));
-  VerifyOrReturn(length == sizeof(uint16_t),
-                 LOG_ERR("SubscriptionCallback: Unexpected length %d. Expected: %d", length,
-                         sizeof(uint16_t)));
+  // Runs on the BT RX thread, decoding and caching happen on the CHIP thread.
+  PostNotification(valueHandle, data, length);
+}
 
-  const uint16_t *value = reinterpret_cast<const uint16_t *>(data);
+void MatterDeviceBle::ReadCharacteristics() {
+  const BleMatterProfile::Profile *profile = mConf.profile;
+  const BleMatterProfile::Characteristic *chrcs[BleDevice::kMaxBatchReads];
+  const struct bt_uuid *uuids[BleDevice::kMaxBatchReads];
+  uint8_t count = 0;
 
-  // Cache received data
-  attributeCache[attributeId] = *value;
-  chip::DeviceLayer::PlatformMgr().ScheduleWork(
-      [](intptr_t context) {
-        auto path = reinterpret_cast<chip::app::ConcreteAttributePath *>(context);
-        BridgeManager::Instance().HandleUpdate(path);
-      },
-      reinterpret_cast<intptr_t>(path));
+  for (uint8_t i = 0; i < profile->characteristicCount && count < ARRAY_SIZE(uuids); i++) {
+    const BleMatterProfile::Characteristic &chrc = profile->characteristics[i];
+    if (chrc.access == BleMatterProfile::Access::READ_ONCE) {
+      chrcs[count] = &chrc;
+      uuids[count] = chrc.uuid;
+      count++;
+    }
+  }
+  if (count == 0) {
+    CompleteSetup();
+    return;
+  }
+
+  DiscoveryRead *read = chip::Platform::New<DiscoveryRead>();
+  int err = -ENOMEM;
+  if (read) {
+    read->dev = this;
+    read->connectionId = mConnectionId;
+    read->count = count;
+    memcpy(read->chrcs, chrcs, count * sizeof(chrcs[0]));
+    err = mBleDevice->ReadMultipleAsync(uuids, count, read, DiscoveryReadCallbackEntry);
+    if (err) {
+      chip::Platform::Delete(read);
+    }
+  }
+  if (err) {
+    LOG_ERR("Read error (err %d). Disconnect", err);
+    mBleDevice->Disconnect();
+  }
+}
+
+void MatterDeviceBle::DiscoveryReadCallback(const DiscoveryRead &read) {
+  // Read on a connection that is gone by now.
+  VerifyOrReturn(mBleDevice && read.connectionId == mConnectionId);
+
+  // Cache everything that arrived in one step.
+  UpdateAttributes(read.values, read.readCount);
+  if (read.readCount < read.count) {
+    LOG_ERR("Read error. Disconnect");
+    mBleDevice->Disconnect();
+    return;
+  }
+  CompleteSetup();
 }
 
 void MatterDeviceBle::DiscoveredCallback() {
   LOG_INF("MatterDeviceBle::DiscoveredCallback");
+  ReadCharacteristics();
+}
 
-  for (const auto &attr : mConf.matterBleMapping) {
-    if (attr.second.first == AttributeTypes::READ_ONCE) {
-      uint16_t buffer;
-      if (mBleDevice->Read(attr.second.second, (uint8_t *)&buffer, 2)) {
-        attributeCache[attr.first.second] = buffer;
-      } else {
-        LOG_ERR("Read error. Disconnect");
-        mBleDevice->Disconnect();
+void MatterDeviceBle::CompleteSetup() {
+  const BleMatterProfile::Profile *profile = mConf.profile;
+  for (uint8_t i = 0; i < profile->characteristicCount; i++) {
+    const BleMatterProfile::Characteristic &chrc = profile->characteristics[i];
+    if (chrc.access == BleMatterProfile::Access::SUBSCRIBE) {
+      // Routes are filled once a subscription succeeded.
+      uint16_t valueHandle = mBleDevice->Subscribe(this, SubscriptionCallbackEntry, chrc.uuid);
+      if (valueHandle) {
+        AddRoute(valueHandle, i);
       }
-    } else if (attr.second.first == AttributeTypes::SUBSCRIBE) {
-      mBleDevice->Subscribe(this, SubscriptionCallbackEntry, attr.second.second);
     }
   }
   SetIsReachable(true);
+  if (mRouteCount > 0) {
+    SuperviseLiveness();
+  }
+  mBleDevice->ApplyIdleLinkProfile();
+}
+
+void MatterDeviceBle::LivenessExpired() {
+  SetIsReachable(false);
+  // Connected but silent. The link layer would keep the connection for its whole supervision
+  // timeout, drop it right away and take the usual way of reconnecting.
+  if (mBleDevice) {
+    LOG_INF("Disconnect silent device");
+    mBleDevice->Disconnect();
+  }
+}
+
+void MatterDeviceBle::RefreshCallback(const struct bt_uuid *uuid, int err, const uint8_t *data,
+                                      uint16_t length) {
+  const BleMatterProfile::Profile *profile = mConf.profile;
+  for (uint8_t i = 0; i < profile->characteristicCount; i++) {
+    const BleMatterProfile::Characteristic &chrc = profile->characteristics[i];
+    if (bt_uuid_cmp(chrc.uuid, uuid) != 0) {
+      continue;
+    }
+    atomic_clear_bit(&mRefreshPending, i);
+    if (err == 0) {
+      UpdateCharacteristic(chrc, data, length, k_cycle_get_32());
+    } else {
+      LOG_INF("Refresh of 0x%x/0x%x failed (err %d)", chrc.clusterId, chrc.attributeId, err);
+    }
+    return;
+  }
 }
 
 void MatterDeviceBle::ConnectedCallback(bool connected, struct bt_conn *conn,
-                                     struct bt_uuid *serviceUuid) {
+                                     const struct bt_uuid *serviceUuid) {
   char str[BT_UUID_STR_LEN];
   bt_uuid_to_str(serviceUuid, str, sizeof(str));
   LOG_INF("MatterDeviceBle::ConnectedCallback connected %d to service uuid %s", connected, str);
@@ -133,10 +242,28 @@ void MatterDeviceBle::ConnectedCallback(bool connected, struct bt_conn *conn,
   if (conn == nullptr) {
     // no devices found
     LOG_INF("Scan did not find any device.");
-    k_timer_start(&mRecoveryTimer, K_MSEC(kRecoveryDelayMs), K_NO_WAIT);
+    ExpireStaleValues();
+    ScheduleReconnect(NextBackoffMs());
   } else if (connected) {
     // found device and automatically connected.
+    k_timer_stop(&mRecoveryTimer);
+    mReconnectState = ReconnectState::CONNECTED;
+    bt_addr_le_copy(&mPeerAddr, bt_conn_get_dst(conn));
+    if (mLostMs >= 0) {
+      uint32_t reconnectMs = k_uptime_get() - mLostMs;
+      BLEConnectivityManager::Instance().NoteReconnected(reconnectMs);
+      LOG_INF("Reconnected after %u ms and %u failed attempt(s)", reconnectMs, mFailedAttempts);
+      mLostMs = -1;
+    }
+    mFailedAttempts = 0;
+
     mBleDevice = chip::Platform::New<BleDevice>(conn);
+    mConnectionId++;
+    // Handles may differ from the previous peer, routes are rebuilt once subscribed.
+    ClearRoutes();
+    if (IS_ENABLED(CONFIG_BRIDGE_BLE_LINK_PROFILES)) {
+      mBleDevice->SetLinkProfile(mConf.profile->link);
+    }
 
     mBleDevice->Discover(this, DiscoveredCallbackEntry, serviceUuid);
   } else {
@@ -148,46 +275,217 @@ void MatterDeviceBle::ConnectedCallback(bool connected, struct bt_conn *conn,
     }
 
     SetIsReachable(false);
+    StopLivenessSupervision();
 //    BridgeManager::Instance().RemoveDeviceEndpoint(this);
 
     LOG_INF("Deleted mBleDevice");
-    k_timer_start(&mRecoveryTimer, K_MSEC(kRecoveryDelayMs), K_NO_WAIT);
+    mLostMs = k_uptime_get();
+    mFailedAttempts = 0;
+    // Usually the peer only restarted or went briefly out of range, try right away.
+    ScheduleReconnect(0);
   }
 }
 
 void MatterDeviceBle::RecoveryTimeoutCallback() {
   LOG_INF("MatterDeviceBle::RecoveryTimeoutCallback");
-  // If there is a bonded device then connect
-  // If there is no bonded device then re-scan but less frequent
-  // If there are multiple bonded devices then ?? -> not implemented
-  if (!BLEConnectivityManager::Instance().ConnectFirstBondedDevice(this, ConnectedCallbackEntry,
-                                                                   mConf.filter)) {
-    BLEConnectivityManager::Instance().Scan(this, ConnectedCallbackEntry, mConf.filter,
-                                            kRecoveryScanTimeoutMs);
+
+  switch (mReconnectState) {
+    case ReconnectState::BACKOFF:
+      StartReconnectAttempt();
+      break;
+    case ReconnectState::AUTO_CONNECT:
+      // The bonded peer did not show up within the window. Nothing to do if it just connected.
+      if (BLEConnectivityManager::Instance().CancelAutoConnect(this)) {
+        ExpireStaleValues();
+        ScheduleReconnect(NextBackoffMs());
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+/****************************
+ * Background refresh
+ ****************************/
+void MatterDeviceBle::RefreshAttribute(chip::ClusterId clusterId, chip::AttributeId attributeId) {
+  VerifyOrReturn(mBleDevice);
+
+  // Notified values arrive by themselves, only read-once characteristics are read again.
+  const BleMatterProfile::Profile *profile = mConf.profile;
+  for (uint8_t i = 0; i < profile->characteristicCount; i++) {
+    const BleMatterProfile::Characteristic &chrc = profile->characteristics[i];
+    if (chrc.access != BleMatterProfile::Access::READ_ONCE || chrc.clusterId != clusterId ||
+        chrc.attributeId != attributeId) {
+      continue;
+    }
+    if (atomic_test_and_set_bit(&mRefreshPending, i)) {
+      return;
+    }
+    if (mBleDevice->ReadAsync(chrc.uuid, this, RefreshCallbackEntry) != 0) {
+      atomic_clear_bit(&mRefreshPending, i);
+    }
+    return;
+  }
+}
+
+/****************************
+ * Writes
+ ****************************/
+CHIP_ERROR MatterDeviceBle::WriteAttribute(chip::ClusterId clusterId, chip::AttributeId attributeId,
+                                           const uint8_t *buffer, uint16_t length) {
+  const BleMatterProfile::Profile *profile = mConf.profile;
+  for (uint8_t i = 0; i < profile->characteristicCount; i++) {
+    const BleMatterProfile::Characteristic &chrc = profile->characteristics[i];
+    if (chrc.access != BleMatterProfile::Access::WRITE || chrc.clusterId != clusterId ||
+        chrc.attributeId != attributeId) {
+      continue;
+    }
+    VerifyOrReturnError(mBleDevice && mWrites, CHIP_ERROR_INCORRECT_STATE);
+    VerifyOrReturnError(length <= sizeof(mWrites[i].data), CHIP_ERROR_INVALID_ARGUMENT);
+
+    uint8_t value[BleDevice::kMaxWriteLength];
+    uint16_t valueLength = chrc.codec(buffer, length, value, sizeof(value));
+    VerifyOrReturnError(valueLength > 0, CHIP_ERROR_INVALID_ARGUMENT);
+
+    // Counted before WriteAsync, which completes a write it replaces right away.
+    k_spinlock_key_t key = k_spin_lock(&mWriteLock);
+    WriteValue previous = mWrites[i];
+    memcpy(mWrites[i].data, buffer, length);
+    mWrites[i].length = length;
+    mWrites[i].outstanding++;
+    k_spin_unlock(&mWriteLock, key);
+
+    int err = mBleDevice->WriteAsync(chrc.uuid, value, valueLength, this, WriteCallbackEntry);
+    if (err) {
+      key = k_spin_lock(&mWriteLock);
+      uint8_t outstanding = mWrites[i].outstanding - 1;
+      mWrites[i] = previous;
+      mWrites[i].outstanding = outstanding;
+      k_spin_unlock(&mWriteLock, key);
+    }
+    VerifyOrReturnError(err != -EBUSY, CHIP_ERROR_BUSY);
+    VerifyOrReturnError(err == 0, CHIP_ERROR_INTERNAL);
+    return CHIP_NO_ERROR;
+  }
+  return CHIP_ERROR_UNSUPPORTED_CHIP_FEATURE;
+}
+
+void MatterDeviceBle::WriteCallback(const struct bt_uuid *uuid, int err, uint32_t queuedCyc) {
+  if (err == 0) {
+    mLatency[kLatencyWrite].RecordCycles(queuedCyc, k_cycle_get_32());
+  }
+
+  const BleMatterProfile::Profile *profile = mConf.profile;
+  for (uint8_t i = 0; mWrites && i < profile->characteristicCount; i++) {
+    const BleMatterProfile::Characteristic &chrc = profile->characteristics[i];
+    if (chrc.access != BleMatterProfile::Access::WRITE || bt_uuid_cmp(chrc.uuid, uuid) != 0) {
+      continue;
+    }
+
+    // Writes of a characteristic complete in order, an older one says nothing about the newest.
+    uint8_t value[GATT_READ_BUF_SIZE];
+    uint16_t length = 0;
+    k_spinlock_key_t key = k_spin_lock(&mWriteLock);
+    bool newest = mWrites[i].outstanding == 1;
+    mWrites[i].outstanding--;
+    if (newest && err == 0) {
+      length = mWrites[i].length;
+      memcpy(value, mWrites[i].data, length);
+    }
+    k_spin_unlock(&mWriteLock, key);
+
+    if (newest && err == 0) {
+      UpdateAttribute(chrc.clusterId, chrc.attributeId, value, length);
+    } else if (err != 0 && err != -ECANCELED) {
+      LOG_INF("Write of 0x%x/0x%x failed (err %d)", chrc.clusterId, chrc.attributeId, err);
+    }
+    return;
   }
 }
 
+/****************************
+ * Reconnect
+ ****************************/
+void MatterDeviceBle::StartReconnectAttempt() {
+  BLEConnectivityManager &mgr = BLEConnectivityManager::Instance();
+  mgr.NoteReconnectAttempt();
+
+  // Before the first connection any bonded peer may be ours.
+  const bt_addr_le_t *peer = bt_addr_le_eq(&mPeerAddr, &bt_addr_le_none) ? nullptr : &mPeerAddr;
+  if (mgr.AutoConnect(this, ConnectedCallbackEntry, mFilter, peer) > 0) {
+    mReconnectState = ReconnectState::AUTO_CONNECT;
+    k_timer_start(&mRecoveryTimer, K_MSEC(kAutoConnectWindowMs), K_NO_WAIT);
+    return;
+  }
+
+  // Not bonded. The first scan after boot gets more time, the peer may still be starting up.
+  uint32_t scanTimeoutMs = (mLostMs < 0 && mFailedAttempts == 0)
+                               ? BLEConnectivityManager::kScanTimeoutMs
+                               : kRecoveryScanTimeoutMs;
+  mReconnectState = ReconnectState::SCANNING;
+  if (mgr.Scan(this, ConnectedCallbackEntry, mFilter, scanTimeoutMs) != CHIP_NO_ERROR) {
+    ScheduleReconnect(NextBackoffMs());
+  }
+}
+
+void MatterDeviceBle::ExpireStaleValues() {
+  // Values restored at boot are only served while the device is expected back. Once the first
+  // attempt failed, the device is reported unreachable like any lost device.
+  if (GetIsStale()) {
+    LOG_INF("Device did not come back, stored values expired");
+    SetIsReachable(false);
+  }
+}
+
+void MatterDeviceBle::ScheduleReconnect(uint32_t delayMs) {
+  LOG_INF("Next reconnect attempt in %u ms", delayMs);
+  mReconnectState = ReconnectState::BACKOFF;
+  k_timer_start(&mRecoveryTimer, K_MSEC(delayMs), K_NO_WAIT);
+}
+
+uint32_t MatterDeviceBle::NextBackoffMs() {
+  uint32_t delayMs = kRecoveryDelayMs;
+  for (uint8_t i = 0; i < mFailedAttempts && delayMs < kRecoveryMaxDelayMs; i++) {
+    delayMs *= 2;
+  }
+  delayMs = MIN(delayMs, kRecoveryMaxDelayMs);
+  if (mFailedAttempts < UINT8_MAX) {
+    mFailedAttempts++;
+  }
+
+  // Jitter keeps devices that were lost together from retrying in lockstep.
+  return delayMs / 2 + sys_rand32_get() % (delayMs / 2 + 1);
+}
+
 /****************************
  * Init
  ****************************/
-void MatterDeviceBle::Init() {
-  LOG_INF("MatterDeviceBle::Init");
+MatterDeviceBle::MatterDeviceBle(struct MatterDeviceConfiguration &conf)
+    : MatterDeviceProfile(conf.profile) {
+  mConf = conf;
+  snprintk(mName, sizeof(mName), "%s-ble%u", mConf.profile->name, mConf.id);
+  mFilter.type = BLEConnectivityManager::DeviceFilter::FILTER_TYPE_UUID;
+  mFilter.filter.serviceUuid = mConf.profile->serviceUuid;
 
   k_timer_init(&mRecoveryTimer, RecoveryTimeoutCallbackEntry, nullptr);
   k_timer_user_data_set(&mRecoveryTimer, this);
 
-  if (!BLEConnectivityManager::Instance().ConnectFirstBondedDevice(this, ConnectedCallbackEntry,
-                                                                   mConf.filter)) {
-    BLEConnectivityManager::Instance().Scan(this, ConnectedCallbackEntry, mConf.filter);
+  const BleMatterProfile::Profile *profile = mConf.profile;
+  for (uint8_t i = 0; i < profile->characteristicCount && !mWrites; i++) {
+    if (profile->characteristics[i].access == BleMatterProfile::Access::WRITE) {
+      mWrites = static_cast<WriteValue *>(
+          chip::Platform::MemoryCalloc(profile->characteristicCount, sizeof(WriteValue)));
+    }
   }
+}
 
-  auto path = chip::Platform::New<chip::app::ConcreteAttributePath>(
+void MatterDeviceBle::Init() {
+  LOG_INF("MatterDeviceBle::Init");
+
+  StartReconnectAttempt();
+
+  BridgeManager::Instance().ReportAttributeChange(
       GetEndpointId(), BridgedDeviceBasicInformation::Id,
       BridgedDeviceBasicInformation::Attributes::NodeLabel::Id);
-  chip::DeviceLayer::PlatformMgr().ScheduleWork(
-      [](intptr_t context) {
-        auto path = reinterpret_cast<chip::app::ConcreteAttributePath *>(context);
-        BridgeManager::Instance().HandleUpdate(path);
-      },
-      reinterpret_cast<intptr_t>(path));
 }
@@ -6,60 +6,104 @@
 #include <zephyr/bluetooth/conn.h>
 #include <zephyr/bluetooth/uuid.h>
 
-#include <map>
-
-#include "matter_device.h"
 #include "ble_connectivity_manager.h"
 #include "ble_device.h"
+#include "ble_matter_profile.h"
+#include "matter_device_profile.h"
 
-#define BT_SERVICE_UUID_CNT 1
-#define BT_CHARACTERISTIC_UUID_CNT 8
+struct DiscoveryRead;
 
-class MatterDeviceBle : public MatterDevice {
+class MatterDeviceBle : public MatterDeviceProfile {
  public:
   static constexpr uint16_t kRecoveryDelayMs = CONFIG_BRIDGE_BT_RECOVERY_INTERVAL_MS;
   static constexpr uint16_t kRecoveryScanTimeoutMs = CONFIG_BRIDGE_BT_RECOVERY_SCAN_TIMEOUT_MS;
-  static constexpr uint8_t kNodeLabelSize = NODE_LABEL_SIZE;
-
-  enum AttributeTypes { READ_ONCE, SUBSCRIBE };
+  static constexpr uint32_t kRecoveryMaxDelayMs = CONFIG_BRIDGE_BT_RECOVERY_MAX_INTERVAL_MS;
+  static constexpr uint32_t kAutoConnectWindowMs = CONFIG_BRIDGE_BT_AUTO_CONNECT_WINDOW_MS;
 
   struct MatterDeviceConfiguration {
-    EmberAfEndpointType *ep;
-    const chip::Span<const EmberAfDeviceType> *deviceTypes;
-    const chip::Span<chip::DataVersion> *dataVersions;
-    char name[kNodeLabelSize];
-    BLEConnectivityManager::DeviceFilter filter;
-    std::map<std::pair<chip::ClusterId, chip::AttributeId>,
-             std::pair<MatterDeviceBle::AttributeTypes, bt_uuid *>>
-        matterBleMapping;
+    const BleMatterProfile::Profile *profile;
+    // Tells devices of the same profile apart, the name keys the device's registry record.
+    uint16_t id;
   };
 
-  MatterDeviceBle(struct MatterDeviceConfiguration &conf) { mConf = conf; };
+  MatterDeviceBle(struct MatterDeviceConfiguration &conf);
 
   ~MatterDeviceBle() {
+    k_timer_stop(&mRecoveryTimer);
+    BLEConnectivityManager::Instance().StopScan(this);
+    BLEConnectivityManager::Instance().CancelAutoConnect(this);
     if (mBleDevice) chip::Platform::Delete(mBleDevice);
+    chip::Platform::MemoryFree(mWrites);
   }
 
   // Callback functions for Ble
-  void SubscriptionCallback(struct bt_uuid *charUuid, const void *data, uint16_t length);
+  void SubscriptionCallback(uint16_t valueHandle, const void *data, uint16_t length);
   void DiscoveredCallback();
-  void ConnectedCallback(bool connected, struct bt_conn *conn, struct bt_uuid *serviceUuid);
+  void DiscoveryReadCallback(const DiscoveryRead &read);
+  // CHIP thread, like the discovery and recovery callbacks.
+  void ConnectedCallback(bool connected, struct bt_conn *conn, const struct bt_uuid *serviceUuid);
 
   void RecoveryTimeoutCallback();
 
   // Interface of matter_device.h
   void Init();
-  const char *GetName() { return mConf.name; }
-  EmberAfEndpointType *GetEndpoint() { return mConf.ep; }
-  const chip::Span<chip::DataVersion> *GetDataVersions() { return mConf.dataVersions; }
-  const chip::Span<const EmberAfDeviceType> *GetDeviceTypes() { return mConf.deviceTypes; }
+  uint8_t GetStartRequirements() const { return kBridgeBtReady; }
+  const char *GetName() { return mName; }
+  EmberAfEndpointType *GetEndpoint() { return mConf.profile->ep; }
+  const chip::Span<chip::DataVersion> *GetDataVersions() { return mConf.profile->dataVersions; }
+  const chip::Span<const EmberAfDeviceType> *GetDeviceTypes() {
+    return mConf.profile->deviceTypes;
+  }
+  void RefreshAttribute(chip::ClusterId clusterId, chip::AttributeId attributeId) override;
+  CHIP_ERROR WriteAttribute(chip::ClusterId clusterId, chip::AttributeId attributeId,
+                            const uint8_t *buffer, uint16_t length) override;
 
- private:
-  struct MatterDeviceConfiguration mConf;
+  void RefreshCallback(const struct bt_uuid *uuid, int err, const uint8_t *data, uint16_t length);
+  void WriteCallback(const struct bt_uuid *uuid, int err, uint32_t queuedCyc);
 
-  std::pair<chip::ClusterId, chip::AttributeId> findClusterAttributeIdByUuid(struct bt_uuid *uuid);
+ protected:
+  void LivenessExpired() override;
 
-  BleDevice *mBleDevice;
+ private:
+  struct MatterDeviceConfiguration mConf;
+  char mName[NODE_LABEL_SIZE];
+  BLEConnectivityManager::DeviceFilter mFilter;
+
+  // Fetch all READ_ONCE characteristics of the profile in one batch. The device is set up once
+  // they arrived.
+  void ReadCharacteristics();
+  // Subscribe, mark the device reachable and switch the link to its idle parameters.
+  void CompleteSetup();
+
+  // Reconnect state machine. Attempts are started by the recovery timer on the CHIP thread. A
+  // bonded peer is waited for with auto-connect, otherwise it is scanned for. Each attempt that
+  // runs out of time doubles the backoff delay.
+  enum class ReconnectState : uint8_t { CONNECTED, BACKOFF, AUTO_CONNECT, SCANNING };
+
+  void StartReconnectAttempt();
+  void ExpireStaleValues();
+  void ScheduleReconnect(uint32_t delayMs);
+  uint32_t NextBackoffMs();
+
+  BleDevice *mBleDevice = nullptr;
+  // Counts connections, tells results of a previous one apart.
+  uint32_t mConnectionId = 0;
+  // Characteristics with a refresh read in flight, by index in the profile.
+  atomic_t mRefreshPending = ATOMIC_INIT(0);
+  // Matter writes by index in the profile. The value of the newest write is cached once that write
+  // succeeded, a failed one leaves the cache at what the device holds.
+  struct WriteValue {
+    uint8_t outstanding;
+    uint8_t data[GATT_READ_BUF_SIZE];
+    uint16_t length;
+  };
+  WriteValue *mWrites = nullptr;
+  struct k_spinlock mWriteLock;
 
   k_timer mRecoveryTimer;
+  ReconnectState mReconnectState = ReconnectState::BACKOFF;
+  uint8_t mFailedAttempts = 0;
+  // Time the connection was lost, -1 while connected or before the first connection.
+  int64_t mLostMs = -1;
+  bt_addr_le_t mPeerAddr = bt_addr_le_none;
 };
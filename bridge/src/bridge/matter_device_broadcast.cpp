@@ -0,0 +1,86 @@
+#include "matter_device_broadcast.h"
+
+#include <app-common/zap-generated/ids/Attributes.h>
+#include <app-common/zap-generated/ids/Clusters.h>
+#include <zephyr/logging/log.h>
+
+#include "bridge_manager.h"
+LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
+
+using namespace ::chip::app::Clusters;
+
+/****************************
+ * Init
+ ****************************/
+MatterDeviceBroadcast::MatterDeviceBroadcast(struct MatterDeviceConfiguration &conf)
+    : MatterDeviceProfile(conf.profile) {
+  mConf = conf;
+  snprintk(mName, sizeof(mName), "%s-adv%u", mConf.profile->name, mConf.id);
+
+  uint8_t clusterCount = mConf.profile->ep->clusterCount;
+  mDataVersions = static_cast<chip::DataVersion *>(
+      chip::Platform::MemoryCalloc(clusterCount, sizeof(chip::DataVersion)));
+  mDataVersionsSpan =
+      chip::Span<chip::DataVersion>(mDataVersions, mDataVersions ? clusterCount : 0);
+
+  // Records carry the values of all readable characteristics.
+  const BleMatterProfile::Profile *profile = mConf.profile;
+  for (uint8_t i = 0; i < profile->characteristicCount; i++) {
+    if (profile->characteristics[i].access != BleMatterProfile::Access::WRITE && !AddRoute(i, i)) {
+      LOG_ERR("%s: No route left for characteristic %d", mName, i);
+    }
+  }
+
+  // Nothing is known about the sensor until its first advertisement.
+  mIsReachable = false;
+}
+
+MatterDeviceBroadcast::~MatterDeviceBroadcast() {
+  BLEConnectivityManager::Instance().StopListening(this);
+  chip::Platform::MemoryFree(mDataVersions);
+}
+
+void MatterDeviceBroadcast::Init() {
+  LOG_INF("MatterDeviceBroadcast::Init %s", mName);
+
+  bool anySensor = bt_addr_le_eq(&mConf.addr, BT_ADDR_LE_ANY);
+  CHIP_ERROR err = BLEConnectivityManager::Instance().Listen(
+      this, AdvertisementCallbackEntry, mConf.profile->serviceUuid,
+      anySensor ? nullptr : &mConf.addr);
+  if (err != CHIP_NO_ERROR) {
+    LOG_ERR("%s: Listening for advertisements failed", mName);
+  }
+  // A sensor that stops broadcasting has no disconnect to tell, only its silence.
+  SuperviseLiveness();
+
+  BridgeManager::Instance().ReportAttributeChange(
+      GetEndpointId(), BridgedDeviceBasicInformation::Id,
+      BridgedDeviceBasicInformation::Attributes::NodeLabel::Id);
+}
+
+/****************************
+ * Advertisements
+ ****************************/
+void MatterDeviceBroadcast::AdvertisementCallbackEntry(void *ctx, const bt_addr_le_t *addr,
+                                                       int8_t rssi, const uint8_t *records,
+                                                       uint8_t length) {
+  reinterpret_cast<MatterDeviceBroadcast *>(ctx)->AdvertisementCallback(addr, rssi, records,
+                                                                        length);
+}
+
+// Runs on the BT RX thread, the records were checked by the BLEConnectivityManager.
+void MatterDeviceBroadcast::AdvertisementCallback(const bt_addr_le_t *addr, int8_t rssi,
+                                                  const uint8_t *records, uint8_t length) {
+  for (uint8_t offset = 0; offset < length; offset += 2 + records[offset + 1]) {
+    PostNotification(records[offset], &records[offset + 2], records[offset + 1]);
+  }
+}
+
+void MatterDeviceBroadcast::HandleNotification(uint16_t valueHandle, const uint8_t *data,
+                                               uint16_t length, uint32_t receivedCyc) {
+  // The first values after a silence make the device reachable and its restored values current.
+  if (!GetIsReachable() || GetIsStale()) {
+    SetIsReachable(true);
+  }
+  MatterDeviceProfile::HandleNotification(valueHandle, data, length, receivedCyc);
+}
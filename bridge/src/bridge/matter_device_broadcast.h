@@ -0,0 +1,56 @@
+#pragma once
+
+#include <app/util/af-types.h>
+#include <lib/core/DataModelTypes.h>
+#include <lib/support/CHIPMem.h>
+#include <zephyr/bluetooth/addr.h>
+
+#include "ble_connectivity_manager.h"
+#include "ble_device.h"
+#include "ble_matter_profile.h"
+#include "matter_device_profile.h"
+
+// Bridged device fed by the advertisements of a sensor instead of a connection, so the number of
+// bridged sensors is not limited by CONFIG_BT_MAX_CONN. See BLEConnectivityManager::Listen for the
+// advertising format. The value records are handed to the CHIP thread through the notification
+// ring with the characteristic index as value handle and handled by MatterDeviceProfile like
+// notifications of a connected device, aggregations included.
+class MatterDeviceBroadcast : public MatterDeviceProfile {
+ public:
+  struct MatterDeviceConfiguration {
+    const BleMatterProfile::Profile *profile;
+    uint16_t id;
+    // Sensor to listen to. BT_ADDR_LE_ANY takes the first one broadcasting the profile's service.
+    bt_addr_le_t addr;
+  };
+
+  MatterDeviceBroadcast(struct MatterDeviceConfiguration &conf);
+  ~MatterDeviceBroadcast();
+
+  void AdvertisementCallback(const bt_addr_le_t *addr, int8_t rssi, const uint8_t *records,
+                             uint8_t length);
+
+  // Interface of matter_device.h
+  void Init();
+  uint8_t GetStartRequirements() const { return kBridgeBtReady; }
+  // A device bound to the first sensor around may get another one after a reboot.
+  bool IsPersistent() const { return !bt_addr_le_eq(&mConf.addr, BT_ADDR_LE_ANY); }
+  const char *GetName() { return mName; }
+  EmberAfEndpointType *GetEndpoint() { return mConf.profile->ep; }
+  const chip::Span<chip::DataVersion> *GetDataVersions() { return &mDataVersionsSpan; }
+  const chip::Span<const EmberAfDeviceType> *GetDeviceTypes() {
+    return mConf.profile->deviceTypes;
+  }
+  void HandleNotification(uint16_t valueHandle, const uint8_t *data, uint16_t length,
+                          uint32_t receivedCyc) override;
+
+ private:
+  static void AdvertisementCallbackEntry(void *ctx, const bt_addr_le_t *addr, int8_t rssi,
+                                         const uint8_t *records, uint8_t length);
+
+  struct MatterDeviceConfiguration mConf;
+  char mName[NODE_LABEL_SIZE];
+  // Every dynamic endpoint needs its own data versions, even if it shares the cluster list.
+  chip::DataVersion *mDataVersions;
+  chip::Span<chip::DataVersion> mDataVersionsSpan;
+};
@@ -46,21 +46,13 @@ static void onReminderCheckEntry(struct k_work *work) {
 void MatterDeviceFixed::onReminderCheck() {
   LOG_INF("MatterDeviceFixed::onReminderCheck");
 
-  auto path = chip::Platform::New<chip::app::ConcreteAttributePath>(
-      GetEndpointId(), LevelControl::Id, LevelControl::Attributes::CurrentLevel::Id);
-
   int64_t remaining = checkdue();
   if (remaining != LONG_MAX) {
     uint16_t value = convertToLevel(remaining);
 
     LOG_INF("MatterDeviceFixed::onReminderCheck set value to %d", value);
-    attributeCache[LevelControl::Attributes::CurrentLevel::Id] = value;
-    chip::DeviceLayer::PlatformMgr().ScheduleWork(
-        [](intptr_t context) {
-          auto path = reinterpret_cast<chip::app::ConcreteAttributePath *>(context);
-          BridgeManager::Instance().HandleUpdate(path);
-        },
-        reinterpret_cast<intptr_t>(path));
+    UpdateAttribute(LevelControl::Id, LevelControl::Attributes::CurrentLevel::Id, &value,
+                    sizeof(value));
     if (!GetIsReachable()) SetIsReachable(true);
   } else {
     if (GetIsReachable()) SetIsReachable(false);
@@ -78,13 +70,7 @@ void MatterDeviceFixed::Init() {
   k_work_init_delayable(&reminderCheckWork.work, onReminderCheckEntry);
   k_work_reschedule(&reminderCheckWork.work, K_NO_WAIT);
 
-  auto path = chip::Platform::New<chip::app::ConcreteAttributePath>(
+  BridgeManager::Instance().ReportAttributeChange(
       GetEndpointId(), BridgedDeviceBasicInformation::Id,
       BridgedDeviceBasicInformation::Attributes::NodeLabel::Id);
-  chip::DeviceLayer::PlatformMgr().ScheduleWork(
-      [](intptr_t context) {
-        auto path = reinterpret_cast<chip::app::ConcreteAttributePath *>(context);
-        BridgeManager::Instance().HandleUpdate(path);
-      },
-      reinterpret_cast<intptr_t>(path));
 }
@@ -26,6 +26,8 @@ class MatterDeviceFixed : public MatterDevice {
 
   // Interface of matter_device.h
   void Init();
+  // The reminders are stored in the file system and due relative to the wall clock.
+  uint8_t GetStartRequirements() const { return kBridgeTimeSynced | kBridgeStorageMounted; }
   const char *GetName() { return mConf.name; }
   EmberAfEndpointType *GetEndpoint() { return mConf.ep; }
   const chip::Span<chip::DataVersion> *GetDataVersions() { return mConf.dataVersions; }
@@ -0,0 +1,114 @@
+#include "matter_device_profile.h"
+
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <new>
+
+#include "bridge_trace.h"
+LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
+
+/****************************
+ * Init
+ ****************************/
+MatterDeviceProfile::MatterDeviceProfile(const BleMatterProfile::Profile *profile)
+    : mProfile(profile) {
+  if (profile->aggregationCount) {
+    mAggregators = static_cast<WindowAggregator *>(
+        chip::Platform::MemoryCalloc(profile->aggregationCount, sizeof(WindowAggregator)));
+    for (uint8_t i = 0; mAggregators && i < profile->aggregationCount; i++) {
+      new (&mAggregators[i]) WindowAggregator();
+      mAggregators[i].Configure(profile->aggregations[i].window, profile->aggregations[i].hop);
+    }
+  }
+}
+
+/****************************
+ * Routing
+ ****************************/
+const MatterDeviceProfile::NotificationRoute *MatterDeviceProfile::findRoute(
+    uint16_t valueHandle) const {
+  for (uint8_t i = 0; i < mRouteCount; i++) {
+    if (mRoutes[i].valueHandle == valueHandle) {
+      return &mRoutes[i];
+    }
+  }
+  return nullptr;
+}
+
+bool MatterDeviceProfile::AddRoute(uint16_t valueHandle, uint8_t characteristicIndex) {
+  VerifyOrReturnValue(mRouteCount < ARRAY_SIZE(mRoutes) && !findRoute(valueHandle), false);
+
+  NotificationRoute &route = mRoutes[mRouteCount++];
+  route = {valueHandle, &mProfile->characteristics[characteristicIndex], nullptr, nullptr};
+
+  for (uint8_t i = 0; mAggregators && i < mProfile->aggregationCount; i++) {
+    if (mProfile->aggregations[i].characteristic == characteristicIndex) {
+      route.aggregation = &mProfile->aggregations[i];
+      route.aggregator = &mAggregators[i];
+      // Samples of a previous connection are too old to be part of the window.
+      route.aggregator->Reset();
+      break;
+    }
+  }
+  return true;
+}
+
+/****************************
+ * Notifications
+ ****************************/
+void MatterDeviceProfile::HandleNotification(uint16_t valueHandle, const uint8_t *data,
+                                             uint16_t length, uint32_t receivedCyc) {
+  const NotificationRoute *route = findRoute(valueHandle);
+  VerifyOrReturn(route, LOG_ERR("HandleNotification: No route for handle %d", valueHandle));
+
+  const BleMatterProfile::Characteristic *chrc = route->characteristic;
+  BRIDGE_TRACE(NOTIFICATION_ROUTED, GetEndpointId(), chrc->clusterId, chrc->attributeId);
+  if (!route->aggregator) {
+    UpdateCharacteristic(*chrc, data, length, receivedCyc);
+    return;
+  }
+
+  uint8_t value[GATT_READ_BUF_SIZE];
+  uint16_t valueLength = chrc->codec(data, length, value, sizeof(value));
+  VerifyOrReturn(valueLength > 0);
+  uint16_t sample = valueLength >= sizeof(uint16_t) ? sys_get_le16(value) : value[0];
+  if (route->aggregator->Add(sample)) {
+    ReportAggregation(*route, receivedCyc);
+  }
+}
+
+void MatterDeviceProfile::UpdateCharacteristic(const BleMatterProfile::Characteristic &chrc,
+                                               const uint8_t *data, uint16_t length,
+                                               uint32_t receivedCyc) {
+  uint8_t value[GATT_READ_BUF_SIZE];
+  uint16_t valueLength = chrc.codec(data, length, value, sizeof(value));
+  UpdateAttribute(chrc.clusterId, chrc.attributeId, value, valueLength, receivedCyc);
+}
+
+void MatterDeviceProfile::ReportAggregation(const NotificationRoute &route,
+                                            uint32_t receivedCyc) {
+  WindowAggregator::Summary summary = route.aggregator->GetSummary();
+  const struct {
+    chip::AttributeId attributeId;
+    uint16_t value;
+  } derived[] = {{route.aggregation->minAttributeId, summary.min},
+                 {route.aggregation->meanAttributeId, summary.mean},
+                 {route.aggregation->maxAttributeId, summary.max}};
+
+  // The cache truncates the little-endian values to the attribute size.
+  AttributeCache::Value values[ARRAY_SIZE(derived)];
+  uint8_t buffers[ARRAY_SIZE(derived)][sizeof(uint16_t)];
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < ARRAY_SIZE(derived); i++) {
+    if (derived[i].attributeId == chip::kInvalidAttributeId) {
+      continue;
+    }
+    sys_put_le16(derived[i].value, buffers[count]);
+    values[count] = {route.characteristic->clusterId, derived[i].attributeId, buffers[count],
+                     sizeof(buffers[count])};
+    count++;
+  }
+  // The window closed with the notification received at receivedCyc.
+  UpdateAttributes(values, count, receivedCyc);
+}
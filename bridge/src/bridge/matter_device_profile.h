@@ -0,0 +1,52 @@
+#pragma once
+
+#include <app/util/af-types.h>
+#include <lib/core/DataModelTypes.h>
+#include <lib/support/CHIPMem.h>
+
+#include "ble_device.h"
+#include "ble_matter_profile.h"
+#include "matter_device.h"
+#include "window_aggregator.h"
+
+// Bridged device exposing the endpoint of a BLE profile. Notifications are routed by value handle
+// to their characteristic, decoded with the profile codec and cached, or fed to the window
+// aggregator of an aggregated characteristic. Connected, broadcasting and simulated devices only
+// differ in where the notifications come from and which value handles they carry.
+class MatterDeviceProfile : public MatterDevice {
+ public:
+  MatterDeviceProfile(const BleMatterProfile::Profile *profile);
+  ~MatterDeviceProfile() { chip::Platform::MemoryFree(mAggregators); }
+
+  void HandleNotification(uint16_t valueHandle, const uint8_t *data, uint16_t length,
+                          uint32_t receivedCyc) override;
+
+ protected:
+  // Routing of notifications by value handle. The characteristic and aggregation point into the
+  // constant profile. Aggregated characteristics feed their aggregator instead of their attribute.
+  struct NotificationRoute {
+    uint16_t valueHandle;
+    const BleMatterProfile::Characteristic *characteristic;
+    const BleMatterProfile::Aggregation *aggregation;
+    WindowAggregator *aggregator;
+  };
+
+  const NotificationRoute *findRoute(uint16_t valueHandle) const;
+  // Route notifications of valueHandle to the characteristic at characteristicIndex of the
+  // profile. Returns false if the handle is routed already or all routes are taken.
+  bool AddRoute(uint16_t valueHandle, uint8_t characteristicIndex);
+  void ClearRoutes() { mRouteCount = 0; }
+  // Decode a value of the characteristic and cache it.
+  void UpdateCharacteristic(const BleMatterProfile::Characteristic &chrc, const uint8_t *data,
+                            uint16_t length, uint32_t receivedCyc);
+
+  const BleMatterProfile::Profile *mProfile;
+  NotificationRoute mRoutes[BleDevice::kMaxSubscriptions];
+  uint8_t mRouteCount = 0;
+
+ private:
+  void ReportAggregation(const NotificationRoute &route, uint32_t receivedCyc);
+
+  // One per aggregation of the profile, nullptr if it has none.
+  WindowAggregator *mAggregators = nullptr;
+};
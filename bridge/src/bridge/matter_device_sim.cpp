@@ -0,0 +1,110 @@
+#include "matter_device_sim.h"
+
+#include <app-common/zap-generated/ids/Attributes.h>
+#include <app-common/zap-generated/ids/Clusters.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "bridge_manager.h"
+LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
+
+using namespace ::chip::app::Clusters;
+
+// Value handles of the simulated characteristics, laid out like declaration, value and CCCD of a
+// real GATT server.
+static constexpr uint16_t kFirstValueHandle = 0x0012;
+static constexpr uint16_t kValueHandleStride = 3;
+
+// Percentage that changes with every sequence number, so every notification is reported.
+static void ScriptedValue(uint16_t sequence, uint8_t index, uint8_t *data) {
+  sys_put_le16((sequence * 7 + index * 13) % 101, data);
+}
+
+/****************************
+ * Init
+ ****************************/
+MatterDeviceSim::MatterDeviceSim(struct MatterDeviceConfiguration &conf)
+    : MatterDeviceProfile(conf.profile) {
+  mConf = conf;
+  snprintk(mName, sizeof(mName), "sim-%s-%u", mConf.profile->name, mConf.id);
+
+  uint8_t clusterCount = mConf.profile->ep->clusterCount;
+  mDataVersions = static_cast<chip::DataVersion *>(
+      chip::Platform::MemoryCalloc(clusterCount, sizeof(chip::DataVersion)));
+  mDataVersionsSpan =
+      chip::Span<chip::DataVersion>(mDataVersions, mDataVersions ? clusterCount : 0);
+
+  const BleMatterProfile::Profile *profile = mConf.profile;
+  for (uint8_t i = 0; i < profile->characteristicCount; i++) {
+    if (profile->characteristics[i].access == BleMatterProfile::Access::SUBSCRIBE) {
+      AddRoute(kFirstValueHandle + i * kValueHandleStride, i);
+    }
+  }
+
+  k_timer_init(&mTimer, TimerEntry, nullptr);
+  k_timer_user_data_set(&mTimer, this);
+  mNotifyWork.dev = this;
+  k_work_init(&mNotifyWork.work, NotifyWorkEntry);
+}
+
+MatterDeviceSim::~MatterDeviceSim() {
+  k_timer_stop(&mTimer);
+  k_work_cancel_sync(&mNotifyWork.work, &mNotifySync);
+  chip::Platform::MemoryFree(mDataVersions);
+}
+
+void MatterDeviceSim::Init() {
+  LOG_INF("MatterDeviceSim::Init %s, notify every %u ms", mName, mConf.intervalMs);
+
+  // Read-once characteristics are there right away, as if read after discovery.
+  const BleMatterProfile::Profile *profile = mConf.profile;
+  for (uint8_t i = 0; i < profile->characteristicCount; i++) {
+    const BleMatterProfile::Characteristic &chrc = profile->characteristics[i];
+    if (chrc.access == BleMatterProfile::Access::READ_ONCE) {
+      uint8_t data[sizeof(uint16_t)];
+      ScriptedValue(0, i, data);
+      UpdateCharacteristic(chrc, data, sizeof(data), k_cycle_get_32());
+    }
+  }
+
+  // Spread the first notifications of devices added together over one interval.
+  uint32_t offsetMs = mConf.intervalMs ? (mConf.id * 7) % mConf.intervalMs : 0;
+  k_timer_start(&mTimer, K_MSEC(offsetMs + 1), K_MSEC(mConf.intervalMs));
+  SuperviseLiveness(mConf.intervalMs);
+
+  BridgeManager::Instance().ReportAttributeChange(
+      GetEndpointId(), BridgedDeviceBasicInformation::Id,
+      BridgedDeviceBasicInformation::Attributes::NodeLabel::Id);
+}
+
+/****************************
+ * Scripted peripheral
+ ****************************/
+void MatterDeviceSim::TimerEntry(k_timer *timer) {
+  MatterDeviceSim *dev = reinterpret_cast<MatterDeviceSim *>(k_timer_user_data_get(timer));
+  if (dev->mSilent) {
+    return;
+  }
+  if (k_work_submit_to_queue(dev->mConf.workQueue, &dev->mNotifyWork.work) != 1) {
+    dev->mOverruns++;
+  }
+}
+
+void MatterDeviceSim::NotifyWorkEntry(struct k_work *work) {
+  auto *notifyWork = CONTAINER_OF(work, decltype(mNotifyWork), work);
+  notifyWork->dev->EmitNotifications();
+}
+
+void MatterDeviceSim::EmitNotifications() {
+  mSequence++;
+  for (uint8_t i = 0; i < mRouteCount; i++) {
+    uint8_t data[sizeof(uint16_t)];
+    ScriptedValue(mSequence, i, data);
+    Notify(mRoutes[i].valueHandle, data, sizeof(data));
+  }
+}
+
+void MatterDeviceSim::Notify(uint16_t valueHandle, const uint8_t *data, uint16_t length) {
+  mNotifications++;
+  PostNotification(valueHandle, data, length);
+}
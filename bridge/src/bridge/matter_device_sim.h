@@ -0,0 +1,79 @@
+#pragma once
+
+#include <app/util/af-types.h>
+#include <lib/core/DataModelTypes.h>
+#include <lib/support/CHIPMem.h>
+#include <zephyr/kernel.h>
+
+#include "ble_matter_profile.h"
+#include "matter_device_profile.h"
+
+// Bridged device fed by a scripted peripheral instead of a BLE connection. It exposes the endpoint
+// of a BLE profile and emits notifications for all of the profile's SUBSCRIBE characteristics at a
+// fixed interval. Notifications take the same way as real ones from then on: handed to the CHIP
+// thread through the notification ring and handled by MatterDeviceProfile like those of a
+// connected device, aggregations included. Used to load the bridge with many devices without any
+// radio, see BridgeSimulation.
+class MatterDeviceSim : public MatterDeviceProfile {
+ public:
+  struct MatterDeviceConfiguration {
+    const BleMatterProfile::Profile *profile;
+    uint16_t id;
+    uint32_t intervalMs;
+    // Runs the notification work, stands in for the BT RX thread.
+    struct k_work_q *workQueue;
+  };
+
+  struct Counters {
+    uint32_t notifications;
+    // Intervals that passed while the previous notification was still pending.
+    uint32_t overruns;
+  };
+
+  MatterDeviceSim(struct MatterDeviceConfiguration &conf);
+  ~MatterDeviceSim();
+
+  // Interface of matter_device.h
+  void Init();
+  bool IsPersistent() const { return false; }
+  const char *GetName() { return mName; }
+  EmberAfEndpointType *GetEndpoint() { return mConf.profile->ep; }
+  const chip::Span<chip::DataVersion> *GetDataVersions() { return &mDataVersionsSpan; }
+  const chip::Span<const EmberAfDeviceType> *GetDeviceTypes() {
+    return mConf.profile->deviceTypes;
+  }
+
+  Counters GetCounters() const { return {mNotifications, mOverruns}; }
+  void ResetCounters() {
+    mNotifications = 0;
+    mOverruns = 0;
+  }
+
+  void EmitNotifications();
+  // A silent device keeps its endpoint but stops notifying, e.g. to measure the time until it is
+  // detected as gone.
+  void SetSilent(bool silent) { mSilent = silent; }
+
+ private:
+  static void TimerEntry(k_timer *timer);
+  static void NotifyWorkEntry(struct k_work *work);
+  void Notify(uint16_t valueHandle, const uint8_t *data, uint16_t length);
+
+  struct MatterDeviceConfiguration mConf;
+  char mName[NODE_LABEL_SIZE];
+  // Every dynamic endpoint needs its own data versions, even if it shares the cluster list.
+  chip::DataVersion *mDataVersions;
+  chip::Span<chip::DataVersion> mDataVersionsSpan;
+
+  uint16_t mSequence = 0;
+
+  k_timer mTimer;
+  struct {
+    struct k_work work;
+    MatterDeviceSim *dev;
+  } mNotifyWork;
+  struct k_work_sync mNotifySync;
+  uint32_t mNotifications = 0;
+  uint32_t mOverruns = 0;
+  volatile bool mSilent = false;
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+// Notifications of one device on their way from the BT RX thread to the CHIP thread. Single
+// producer, single consumer: Push only from the thread receiving the notifications, Peek and Pop
+// only from the thread draining them. Neither side locks, the head is only written by the
+// consumer and the tail only by the producer.
+class NotificationRing {
+ public:
+  static constexpr uint8_t kSize = CONFIG_BRIDGE_NOTIFICATION_RING_SIZE;
+  static_assert((kSize & (kSize - 1)) == 0, "Notification ring size must be a power of 2");
+  // Longest payload kept, longer notifications are dropped. Matches the default ATT MTU.
+  static constexpr uint8_t kMaxPayload = 20;
+
+  struct Record {
+    uint32_t receivedCyc;
+    uint16_t valueHandle;
+    uint8_t length;
+    uint8_t data[kMaxPayload];
+  };
+
+  // Backpressure counters. dropped counts notifications lost to a full ring, oversized those
+  // longer than kMaxPayload.
+  struct Stats {
+    uint32_t pushed;
+    uint32_t dropped;
+    uint32_t oversized;
+    uint32_t batches;
+    uint8_t highWaterMark;
+  };
+
+  bool Push(uint16_t valueHandle, const void *data, uint16_t length, uint32_t receivedCyc) {
+    if (length > kMaxPayload) {
+      atomic_inc(&mOversized);
+      return false;
+    }
+    atomic_val_t tail = atomic_get(&mTail);
+    atomic_val_t used = tail - atomic_get(&mHead);
+    if (used >= kSize) {
+      atomic_inc(&mDropped);
+      return false;
+    }
+
+    Record &record = mRecords[tail & (kSize - 1)];
+    record.receivedCyc = receivedCyc;
+    record.valueHandle = valueHandle;
+    record.length = length;
+    memcpy(record.data, data, length);
+    // Publishes the record, atomic_set is a full barrier.
+    atomic_set(&mTail, tail + 1);
+
+    atomic_inc(&mPushed);
+    atomic_val_t max = atomic_get(&mHighWaterMark);
+    while (used + 1 > max && !atomic_cas(&mHighWaterMark, max, used + 1)) {
+      max = atomic_get(&mHighWaterMark);
+    }
+    return true;
+  }
+
+  // Oldest record, nullptr if the ring is empty. Stays valid until Pop.
+  const Record *Peek() const {
+    atomic_val_t head = atomic_get(&mHead);
+    if (head == atomic_get(&mTail)) {
+      return nullptr;
+    }
+    return &mRecords[head & (kSize - 1)];
+  }
+
+  void Pop() { atomic_inc(&mHead); }
+
+  bool IsEmpty() const { return atomic_get(&mHead) == atomic_get(&mTail); }
+
+  void NoteBatch() { atomic_inc(&mBatches); }
+
+  Stats GetStats() const {
+    return {static_cast<uint32_t>(atomic_get(&mPushed)),
+            static_cast<uint32_t>(atomic_get(&mDropped)),
+            static_cast<uint32_t>(atomic_get(&mOversized)),
+            static_cast<uint32_t>(atomic_get(&mBatches)),
+            static_cast<uint8_t>(atomic_get(&mHighWaterMark))};
+  }
+
+  void ResetStats() {
+    atomic_clear(&mPushed);
+    atomic_clear(&mDropped);
+    atomic_clear(&mOversized);
+    atomic_clear(&mBatches);
+    atomic_clear(&mHighWaterMark);
+  }
+
+ private:
+  Record mRecords[kSize];
+  // Free running counters, the index into mRecords is taken modulo kSize.
+  atomic_t mHead = ATOMIC_INIT(0);
+  atomic_t mTail = ATOMIC_INIT(0);
+
+  atomic_t mPushed = ATOMIC_INIT(0);
+  atomic_t mDropped = ATOMIC_INIT(0);
+  atomic_t mOversized = ATOMIC_INIT(0);
+  atomic_t mBatches = ATOMIC_INIT(0);
+  atomic_t mHighWaterMark = ATOMIC_INIT(0);
+};
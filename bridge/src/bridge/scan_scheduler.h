@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdint.h>
+#include <zephyr/bluetooth/gap.h>
+#include <zephyr/sys/util.h>
+
+// Scan parameters chosen from what else needs the radio. Scanning for bridged devices competes
+// with the connections to them and with CHIPoBLE advertising while the bridge is commissioned: a
+// connection or advertising event falling into a scan window either preempts the scanner or is
+// skipped. The window stays the same, the interval doubles with every connection and while
+// advertising, up to BT_GAP_SCAN_SLOW_INTERVAL_1.
+//
+// Active scanning sends a scan request to every advertiser and listens for its response. It is
+// only used while a scan request filters by service UUID, which peripherals may put into their
+// scan response, and no advertising has to be kept on schedule. Otherwise scanning is passive.
+//
+// Also keeps the account of the time spent scanning, weighted with the window / interval ratio of
+// the parameters it ran with. Times are passed in, nothing here reads a clock or touches the radio.
+class ScanScheduler {
+ public:
+  static constexpr uint16_t kWindow = BT_GAP_SCAN_FAST_WINDOW;
+  static constexpr uint16_t kMinInterval = BT_GAP_SCAN_FAST_INTERVAL;
+  static constexpr uint16_t kMaxInterval = BT_GAP_SCAN_SLOW_INTERVAL_1;
+
+  struct Conditions {
+    uint8_t connections;
+    bool advertising;
+    bool needsScanResponse;
+  };
+
+  // interval and window in units of 0.625 ms, as in struct bt_le_scan_param.
+  struct Parameters {
+    bool active;
+    uint16_t interval;
+    uint16_t window;
+
+    bool operator==(const Parameters &other) const {
+      return active == other.active && interval == other.interval && window == other.window;
+    }
+    bool operator!=(const Parameters &other) const { return !(*this == other); }
+  };
+
+  struct Stats {
+    uint32_t scanMs;
+    uint32_t activeScanMs;
+    // Scan time weighted with the duty cycle, the time the radio actually listened.
+    uint32_t radioOnMs;
+    uint32_t parameterChanges;
+  };
+
+  static Parameters Select(const Conditions &conditions) {
+    // Beyond five doublings the interval is at its maximum anyway.
+    uint8_t shift = MIN(conditions.connections + (conditions.advertising ? 1 : 0), 5);
+    uint16_t interval = MIN((uint32_t)kMinInterval << shift, kMaxInterval);
+    return {conditions.needsScanResponse && !conditions.advertising, interval, kWindow};
+  }
+
+  // Scanning started, or continues with other parameters.
+  void Start(const Parameters &parameters, int64_t nowMs) {
+    Stop(nowMs);
+    if (mStarted && parameters != mParameters) {
+      mStats.parameterChanges++;
+    }
+    mParameters = parameters;
+    mStartMs = nowMs;
+    mStarted = true;
+    mRunning = true;
+  }
+
+  void Stop(int64_t nowMs) {
+    if (mRunning) {
+      Account(mStats, nowMs);
+      mRunning = false;
+    }
+  }
+
+  // Includes the running scan.
+  Stats GetStats(int64_t nowMs) const {
+    Stats stats = mStats;
+    if (mRunning) {
+      Account(stats, nowMs);
+    }
+    return stats;
+  }
+
+  bool IsRunning() const { return mRunning; }
+  Parameters GetParameters() const { return mParameters; }
+
+ private:
+  void Account(Stats &stats, int64_t nowMs) const {
+    uint32_t elapsedMs = nowMs - mStartMs;
+    stats.scanMs += elapsedMs;
+    if (mParameters.active) {
+      stats.activeScanMs += elapsedMs;
+    }
+    stats.radioOnMs += (uint64_t)elapsedMs * mParameters.window / mParameters.interval;
+  }
+
+  Parameters mParameters = {true, kMinInterval, kWindow};
+  int64_t mStartMs = 0;
+  bool mStarted = false;
+  bool mRunning = false;
+  Stats mStats = {};
+};
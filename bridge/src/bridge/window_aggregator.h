@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdint.h>
+#include <zephyr/sys/util.h>
+
+// Rolling min, mean and max of the last `window` samples of a value. The window closes every `hop`
+// samples, the summary is then reported instead of every single sample.
+//
+// Each sample costs O(1) amortized and nothing is rescanned: the sum is updated with the sample
+// entering and the one leaving the window, min and max are the front of monotonic queues of sample
+// positions. A new sample removes the samples from the back of a queue that can no longer become
+// the extreme, the front leaves once it drops out of the window.
+class WindowAggregator {
+ public:
+  static constexpr uint8_t kMaxWindow = 64;
+  // Positions are kept as uint8_t, the samples of a window must be told apart modulo 256.
+  static_assert(256 % kMaxWindow == 0, "Window size must divide 256");
+
+  struct Summary {
+    uint16_t min;
+    uint16_t mean;
+    uint16_t max;
+    // Samples the summary is taken over, less than the window until it filled up once.
+    uint8_t count;
+  };
+
+  void Configure(uint8_t window, uint8_t hop) {
+    mWindow = CLAMP(window, 1, kMaxWindow);
+    mHop = MAX(hop, 1);
+    Reset();
+  }
+
+  void Reset() {
+    mAdded = 0;
+    mSum = 0;
+    mSinceClose = 0;
+    mMin = {};
+    mMax = {};
+  }
+
+  // Returns true if the sample closed the window.
+  bool Add(uint16_t sample) {
+    uint8_t position = static_cast<uint8_t>(mAdded);
+    if (mAdded >= mWindow) {
+      mSum -= mSamples[static_cast<uint8_t>(position - mWindow) % kMaxWindow];
+    }
+    mSamples[position % kMaxWindow] = sample;
+    mSum += sample;
+    mAdded++;
+
+    Push(mMin, position, sample, true);
+    Push(mMax, position, sample, false);
+
+    if (++mSinceClose < mHop) {
+      return false;
+    }
+    mSinceClose = 0;
+    return true;
+  }
+
+  Summary GetSummary() const {
+    uint8_t count = MIN(mAdded, mWindow);
+    if (count == 0) {
+      return {};
+    }
+    return {mSamples[mMin.positions[mMin.head] % kMaxWindow],
+            static_cast<uint16_t>((mSum + count / 2) / count),
+            mSamples[mMax.positions[mMax.head] % kMaxWindow], count};
+  }
+
+ private:
+  struct MonotonicQueue {
+    uint8_t positions[kMaxWindow];
+    uint8_t head;
+    uint8_t size;
+  };
+
+  void Push(MonotonicQueue &queue, uint8_t position, uint16_t sample, bool keepMin) {
+    // One sample leaves the window per sample added, so at most one leaves the front.
+    if (queue.size && static_cast<uint8_t>(position - queue.positions[queue.head]) >= mWindow) {
+      queue.head = (queue.head + 1) % kMaxWindow;
+      queue.size--;
+    }
+    while (queue.size) {
+      uint8_t back = queue.positions[(queue.head + queue.size - 1) % kMaxWindow];
+      uint16_t backSample = mSamples[back % kMaxWindow];
+      if (keepMin ? backSample < sample : backSample > sample) {
+        break;
+      }
+      queue.size--;
+    }
+    queue.positions[(queue.head + queue.size) % kMaxWindow] = position;
+    queue.size++;
+  }
+
+  uint16_t mSamples[kMaxWindow];
+  MonotonicQueue mMin = {};
+  MonotonicQueue mMax = {};
+  uint32_t mAdded = 0;
+  uint32_t mSum = 0;
+  uint8_t mWindow = kMaxWindow;
+  uint8_t mHop = 1;
+  uint8_t mSinceClose = 0;
+};
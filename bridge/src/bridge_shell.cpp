@@ -11,7 +11,7 @@
 #include "bridge/oob_exchange_manager.h"
 
 static int init(const struct shell *shell, size_t argc, char **argv) {
-  AppTask::InitBridge();
+  AppTask::StartBridge();
   return 0;
 }
 
@@ -94,6 +94,384 @@ static int memory_stats(const struct shell *shell, size_t argc, char **argv) {
   return 0;
 }
 
+#include <app-common/zap-generated/callback.h>
+#include <app-common/zap-generated/ids/Attributes.h>
+#include <app-common/zap-generated/ids/Clusters.h>
+#include <app/util/attribute-storage.h>
+#include <platform/PlatformManager.h>
+#include "bridge/bridge_manager.h"
+#ifdef CONFIG_BRIDGE_SIMULATION
+#include "bridge/bridge_simulation.h"
+#endif
+
+#include <map>
+
+// Simulated devices filling the free endpoints for bench_read do not notify while it runs.
+static constexpr uint32_t kBenchSimIntervalMs = 60000;
+
+static int bench_read(const struct shell *shell, size_t argc, char **argv) {
+  using namespace ::chip::app::Clusters;
+  uint32_t iterations = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000;
+  uint8_t buffer[4];
+  uint32_t devices = 0;
+  uint64_t cycles = 0;
+  uint64_t mapCycles = 0;
+  uint64_t tableCycles = 0;
+  uint8_t simulated = 0;
+
+#ifdef CONFIG_BRIDGE_SIMULATION
+  // Lookups are timed with every dynamic endpoint taken, free ones get simulated devices.
+  for (uint8_t i = 0; i < BridgeManager::kMaxDynamicEndpoints; i++) {
+    if (!BridgeManager::Instance().GetDevice(i)) {
+      simulated++;
+    }
+  }
+  BridgeSimulation &simulation = BridgeSimulation::Instance();
+  if (simulated > 0 && simulation.Start(simulated, kBenchSimIntervalMs) == CHIP_NO_ERROR) {
+    simulation.Silence(simulated);
+    // The devices are added on the CHIP thread.
+    k_sleep(K_MSEC(BridgeSimulation::kSettleMs));
+  } else {
+    simulated = 0;
+  }
+#endif
+
+  // The read callback and the device table belong to the CHIP thread.
+  chip::DeviceLayer::PlatformMgr().LockChipStack();
+
+  // The std::map keyed by endpoint index that BridgeManager used before the dispatch table, filled
+  // with the same devices to time both lookups side by side.
+  std::map<uint8_t, MatterDevice *> devicesMap;
+  for (uint8_t i = 0; i < BridgeManager::kMaxDynamicEndpoints; i++) {
+    if (MatterDevice *dev = BridgeManager::Instance().GetDevice(i)) {
+      devicesMap[i] = dev;
+    }
+  }
+
+  for (uint8_t i = 0; i < BridgeManager::kMaxDynamicEndpoints; i++) {
+    MatterDevice *dev = BridgeManager::Instance().GetDevice(i);
+    if (!dev) continue;
+
+    const EmberAfAttributeMetadata *metadata = emberAfLocateAttributeMetadata(
+        dev->GetEndpointId(), BridgedDeviceBasicInformation::Id,
+        BridgedDeviceBasicInformation::Attributes::Reachable::Id);
+    if (!metadata) continue;
+
+    // volatile keeps the compiler from hoisting the lookups out of the loops.
+    volatile uint8_t key = i;
+    MatterDevice *volatile found;
+    uint32_t start = k_cycle_get_32();
+    for (uint32_t n = 0; n < iterations; n++) {
+      found = devicesMap.contains(key) ? devicesMap[key] : nullptr;
+    }
+    mapCycles += k_cycle_get_32() - start;
+
+    start = k_cycle_get_32();
+    for (uint32_t n = 0; n < iterations; n++) {
+      found = BridgeManager::Instance().GetDevice(key);
+    }
+    tableCycles += k_cycle_get_32() - start;
+    (void)found;
+
+    start = k_cycle_get_32();
+    for (uint32_t n = 0; n < iterations; n++) {
+      emberAfExternalAttributeReadCallback(dev->GetEndpointId(), BridgedDeviceBasicInformation::Id,
+                                           metadata, buffer, sizeof(buffer));
+    }
+    cycles += k_cycle_get_32() - start;
+    devices++;
+  }
+
+  chip::DeviceLayer::PlatformMgr().UnlockChipStack();
+
+#ifdef CONFIG_BRIDGE_SIMULATION
+  if (simulated > 0) {
+    BridgeSimulation::Sample sample;
+    simulation.Stop(sample);
+  }
+#endif
+
+  if (devices == 0 || iterations == 0) {
+    shell_print(shell, "No bridged devices registered.");
+    return 0;
+  }
+  uint64_t perRead = cycles / (devices * iterations);
+  uint64_t perMapLookup = mapCycles / (devices * iterations);
+  uint64_t perTableLookup = tableCycles / (devices * iterations);
+  shell_print(shell,
+              "%u devices (%u simulated) x %u reads: %llu cycles (%llu ns) per read callback",
+              devices, simulated, iterations, perRead, k_cyc_to_ns_floor64(perRead));
+  shell_print(shell, "device lookup: std::map %llu cycles (%llu ns), table %llu cycles (%llu ns)",
+              perMapLookup, k_cyc_to_ns_floor64(perMapLookup), perTableLookup,
+              k_cyc_to_ns_floor64(perTableLookup));
+  return 0;
+}
+
+static int report_stats(const struct shell *shell, size_t argc, char **argv) {
+  BridgeManager::ReportQueueStats stats = BridgeManager::Instance().GetReportQueueStats();
+  shell_print(shell, "report queue: size %u, high-water mark %u, overflows %u",
+              BridgeManager::kReportQueueSize, stats.highWaterMark, stats.overflows);
+  shell_print(shell, "coalesced %u, skipped unchanged %u", stats.coalesced, stats.unchanged);
+  return 0;
+}
+
+static int notification_stats(const struct shell *shell, size_t argc, char **argv) {
+  bool reset = argc > 1 && strcmp(argv[1], "reset") == 0;
+  if (argc > 1 && !reset) {
+    shell_error(shell, "Unknown argument %s", argv[1]);
+    return -EINVAL;
+  }
+
+  for (uint8_t i = 0; i < BridgeManager::kMaxDynamicEndpoints; i++) {
+    MatterDevice *dev = BridgeManager::Instance().GetDevice(i);
+    if (!dev) continue;
+
+    if (reset) {
+      dev->ResetNotificationStats();
+      continue;
+    }
+    NotificationRing::Stats stats = dev->GetNotificationStats();
+    shell_print(shell,
+                "%s: %u notifications in %u batches, dropped %u full, %u oversized, "
+                "high-water mark %u of %u",
+                dev->GetName(), stats.pushed, stats.batches, stats.dropped, stats.oversized,
+                stats.highWaterMark, NotificationRing::kSize);
+  }
+  return 0;
+}
+
+static int liveness(const struct shell *shell, size_t argc, char **argv) {
+  bool reset = argc > 1 && strcmp(argv[1], "reset") == 0;
+  if (argc > 1 && !reset) {
+    shell_error(shell, "Unknown argument %s", argv[1]);
+    return -EINVAL;
+  }
+
+  for (uint8_t i = 0; i < BridgeManager::kMaxDynamicEndpoints; i++) {
+    MatterDevice *dev = BridgeManager::Instance().GetDevice(i);
+    if (!dev) continue;
+
+    if (reset) {
+      dev->ResetLivenessStats();
+      continue;
+    }
+    const LivenessTracker &liveness = dev->GetLiveness();
+    if (!liveness.IsActive()) {
+      shell_print(shell, "%s: %s, not supervised", dev->GetName(),
+                  dev->GetIsReachable() ? "reachable" : "unreachable");
+      continue;
+    }
+    LivenessTracker::Stats stats = liveness.GetStats();
+    shell_print(shell,
+                "%s: %s, interval %u ms, timeout %u ms, %u expirations, detected after %u ms "
+                "(max %u ms)",
+                dev->GetName(), dev->GetIsReachable() ? "reachable" : "unreachable",
+                liveness.GetIntervalMs(), liveness.GetTimeoutMs(), stats.expirations,
+                stats.lastDetectionMs, stats.maxDetectionMs);
+  }
+  return 0;
+}
+
+static int stats(const struct shell *shell, size_t argc, char **argv) {
+  static const char *const kStageNames[MatterDevice::kLatencyStageCount] = {
+      "cache", "coalesce", "dispatch", "report", "total", "write"};
+  bool reset = argc > 1 && strcmp(argv[1], "reset") == 0;
+  if (argc > 1 && !reset) {
+    shell_error(shell, "Unknown argument %s", argv[1]);
+    return -EINVAL;
+  }
+
+  for (uint8_t i = 0; i < BridgeManager::kMaxDynamicEndpoints; i++) {
+    MatterDevice *dev = BridgeManager::Instance().GetDevice(i);
+    if (!dev) continue;
+
+    if (reset) {
+      dev->ResetLatency();
+      continue;
+    }
+    shell_print(shell, "%s (endpoint %d)", dev->GetName(), dev->GetEndpointId());
+    for (uint8_t stage = 0; stage < MatterDevice::kLatencyStageCount; stage++) {
+      const LatencyHistogram &histogram =
+          dev->GetLatency(static_cast<MatterDevice::LatencyStage>(stage));
+      uint32_t count = histogram.GetCount();
+      shell_print(shell, "  %-8s n %u, p50 <%u us, p99 <%u us, max %u us", kStageNames[stage],
+                  count, histogram.GetPercentileUs(50), histogram.GetPercentileUs(99),
+                  histogram.GetMaxUs());
+      if (count == 0) continue;
+
+      // Buckets from the first to the last one in use, bucket i counts [2^i, 2^(i+1)) us.
+      uint8_t first = 0;
+      uint8_t last = LatencyHistogram::kBuckets - 1;
+      while (histogram.GetBucket(first) == 0) first++;
+      while (histogram.GetBucket(last) == 0) last--;
+      for (uint8_t b = first; b <= last; b++) {
+        bool open = b == LatencyHistogram::kBuckets - 1;
+        shell_print(shell, "    %s%8u us %u", open ? ">=" : "< ", (uint32_t)BIT(open ? b : b + 1),
+                    histogram.GetBucket(b));
+      }
+    }
+  }
+
+  if (reset) {
+    shell_print(shell, "Latency histograms reset.");
+  }
+  return 0;
+}
+
+#ifdef CONFIG_BRIDGE_SIMULATION
+static void print_sample(const struct shell *shell, const BridgeSimulation::Sample &sample) {
+  uint32_t elapsedMs = MAX(sample.elapsedMs, 1);
+  shell_print(shell,
+              "%2u devices: %u notifications (%u dropped), %u reports (%u/s), %u overruns, "
+              "%u coalesced, %u dropped, p50 <%u us, p99 <%u us, max %u us",
+              sample.devices, sample.notifications, sample.dropped, sample.reports,
+              (uint32_t)((uint64_t)sample.reports * 1000 / elapsedMs), sample.overruns,
+              sample.coalesced, sample.overflows, sample.p50Us, sample.p99Us, sample.maxUs);
+}
+
+static int sim_start(const struct shell *shell, size_t argc, char **argv) {
+  uint8_t count = strtoul(argv[1], NULL, 10);
+  uint32_t intervalMs = strtoul(argv[2], NULL, 10);
+  CHIP_ERROR err = BridgeSimulation::Instance().Start(count, intervalMs);
+  if (err != CHIP_NO_ERROR) {
+    shell_error(shell, "Cannot start simulation (%" CHIP_ERROR_FORMAT ")", err.Format());
+    return -EINVAL;
+  }
+  shell_print(shell, "%u simulated devices notify every %u ms", count, intervalMs);
+  return 0;
+}
+
+static int sim_stop(const struct shell *shell, size_t argc, char **argv) {
+  BridgeSimulation::Sample sample;
+  if (BridgeSimulation::Instance().Stop(sample) != CHIP_NO_ERROR) {
+    shell_error(shell, "No simulation running");
+    return -EINVAL;
+  }
+  print_sample(shell, sample);
+  return 0;
+}
+
+static int sim_silence(const struct shell *shell, size_t argc, char **argv) {
+  uint8_t count = strtoul(argv[1], NULL, 10);
+  if (BridgeSimulation::Instance().Silence(count) != CHIP_NO_ERROR) {
+    shell_error(shell, "No simulation running with %u devices", count);
+    return -EINVAL;
+  }
+  shell_print(shell, "%u simulated devices silent, see \"matter_bridge liveness\"", count);
+  return 0;
+}
+
+static int sim_bench(const struct shell *shell, size_t argc, char **argv) {
+  uint32_t intervalMs = strtoul(argv[1], NULL, 10);
+  uint32_t stepMs = argc > 2 ? strtoul(argv[2], NULL, 10) * 1000 : 10000;
+  CHIP_ERROR err = BridgeSimulation::Instance().Benchmark(intervalMs, stepMs);
+  if (err != CHIP_NO_ERROR) {
+    shell_error(shell, "Cannot start benchmark (%" CHIP_ERROR_FORMAT ")", err.Format());
+    return -EINVAL;
+  }
+  shell_print(shell, "Benchmark running, see \"matter_bridge sim results\"");
+  return 0;
+}
+
+static int sim_results(const struct shell *shell, size_t argc, char **argv) {
+  const BridgeSimulation::Sample *samples;
+  uint8_t count = BridgeSimulation::Instance().GetSamples(&samples);
+  for (uint8_t i = 0; i < count; i++) {
+    print_sample(shell, samples[i]);
+  }
+  return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(
+    sub_sim,
+    SHELL_CMD_ARG(start, NULL, "Add simulated devices. <count> <interval ms>", sim_start, 3, 0),
+    SHELL_CMD(stop, NULL, "Remove the simulated devices and print the measurement.", sim_stop),
+    SHELL_CMD_ARG(silence, NULL, "Stop the notifications of the first devices. <count>",
+                  sim_silence, 2, 0),
+    SHELL_CMD_ARG(bench, NULL,
+                  "Sweep the device count up to the free endpoints. <interval ms> [<step s>]",
+                  sim_bench, 2, 1),
+    SHELL_CMD(results, NULL, "Print the samples of the last benchmark.", sim_results),
+    SHELL_SUBCMD_SET_END);
+#endif
+
+#ifdef CONFIG_BRIDGE_TRACE
+#include "bridge/bridge_trace.h"
+// One header line, then one line per record with the raw little endian record in hex. Decode with
+// scripts/bridge_trace_decode.py.
+static int trace_dump(const struct shell *shell, size_t argc, char **argv) {
+  uint32_t written = BridgeTrace::GetWritten();
+  uint32_t first = written > BridgeTrace::kBufferSize ? written - BridgeTrace::kBufferSize : 0;
+  shell_print(shell, "btrace v%u hz %u first %u written %u", BridgeTrace::kFormatVersion,
+              sys_clock_hw_cycles_per_sec(), first, written);
+
+  char hex[sizeof(BridgeTrace::TraceRecord) * 2 + 1];
+  for (uint32_t sequence = first; sequence < written; sequence++) {
+    BridgeTrace::TraceRecord record;
+    // Records overwritten while dumping are skipped, the decoder shows the gap.
+    if (!BridgeTrace::Get(sequence, record)) continue;
+    bin2hex(reinterpret_cast<const uint8_t *>(&record), sizeof(record), hex, sizeof(hex));
+    shell_print(shell, "btrace %u %s", sequence, hex);
+  }
+  return 0;
+}
+
+static int trace_clear(const struct shell *shell, size_t argc, char **argv) {
+  BridgeTrace::Clear();
+  shell_print(shell, "Trace cleared.");
+  return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(
+    sub_trace,
+    SHELL_CMD(dump, NULL, "Print the trace records for scripts/bridge_trace_decode.py.",
+              trace_dump),
+    SHELL_CMD(clear, NULL, "Discard the trace records.", trace_clear), SHELL_SUBCMD_SET_END);
+#endif
+
+static int startup_stats(const struct shell *shell, size_t argc, char **argv) {
+  BridgeManager::StartupStats stats = BridgeManager::Instance().GetStartupStats();
+  shell_print(shell, "endpoints %lld ms, BT ready %lld ms, network up %lld ms", stats.endpointsMs,
+              stats.btReadyMs, stats.networkUpMs);
+  shell_print(shell, "time synced %lld ms, storage mounted %lld ms, first report %lld ms",
+              stats.timeSyncedMs, stats.storageMountedMs, stats.firstReportMs);
+  return 0;
+}
+
+#include "bridge/ble_connectivity_manager.h"
+#include "bridge/ble_device.h"
+static int ble_stats(const struct shell *shell, size_t argc, char **argv) {
+  BLEConnectivityManager::BringUpStats stats = BLEConnectivityManager::Instance().GetBringUpStats();
+  shell_print(shell, "connected %u, connect failures %u, candidate fallbacks %u",
+              stats.connected, stats.connectFailures, stats.candidateFallbacks);
+  shell_print(shell, "last bring-up %u ms", stats.lastBringUpMs);
+
+  BLEConnectivityManager::ReconnectStats reconnect =
+      BLEConnectivityManager::Instance().GetReconnectStats();
+  shell_print(shell, "reconnect attempts %u, reconnects %u, last %u ms, max %u ms",
+              reconnect.attempts, reconnect.reconnects, reconnect.lastReconnectMs,
+              reconnect.maxReconnectMs);
+
+  BLEConnectivityManager::RadioStats radio = BLEConnectivityManager::Instance().GetRadioStats();
+  shell_print(shell, "scan %u ms, initiate %u ms, auto-connect %u ms, radio on ~%u ms",
+              radio.scanMs, radio.initiateMs, radio.autoConnectMs, radio.radioOnMs);
+  shell_print(shell, "active scan %u ms, scan radio on ~%u ms, scan parameter changes %u",
+              radio.activeScanMs, radio.scanRadioOnMs, radio.scanParameterChanges);
+
+  BleDevice::WriteStats writes = BleDevice::GetWriteStats();
+  shell_print(shell, "writes %u, coalesced %u, without response %u, with response %u, failed %u",
+              writes.queued, writes.coalesced, writes.withoutResponse, writes.withResponse,
+              writes.failed);
+
+#ifdef CONFIG_BRIDGE_BROADCAST
+  BLEConnectivityManager::AdvertisementStats adv =
+      BLEConnectivityManager::Instance().GetAdvertisementStats();
+  shell_print(shell, "advertisements %u, duplicates %u, malformed %u", adv.received,
+              adv.duplicates, adv.malformed);
+#endif
+  return 0;
+}
+
 #include "reminders/persistence/persistence.h"
 static int delete_file(const struct shell *shell, size_t argc, char **argv) {
   fs_init(false);
@@ -105,7 +483,31 @@ static int delete_file(const struct shell *shell, size_t argc, char **argv) {
 SHELL_STATIC_SUBCMD_SET_CREATE(
     sub_matter_bridge, 
     SHELL_CMD(memory_stats, NULL, "Inits the bridge.", memory_stats),
-    SHELL_CMD(init, NULL, "Inits the bridge.", init),
+    SHELL_CMD(init, NULL, "Starts the bridge without waiting for readiness signals.", init),
+    SHELL_CMD_ARG(bench_read, NULL,
+                  "Time the attribute read callback and the device lookup. [<iterations>]",
+                  bench_read, 1, 1),
+    SHELL_CMD(report_stats, NULL, "Print attribute report queue statistics.", report_stats),
+    SHELL_CMD_ARG(notification_stats, NULL,
+                  "Print the notification ring statistics per device. [reset]",
+                  notification_stats, 1, 1),
+    SHELL_CMD_ARG(liveness, NULL, "Print the liveness supervision per device. [reset]", liveness,
+                  1, 1),
+    SHELL_CMD_ARG(stats, NULL,
+                  "Print per-device latency histograms of the notification to report path. "
+                  "[reset]",
+                  stats, 1, 1),
+#ifdef CONFIG_BRIDGE_SIMULATION
+    SHELL_CMD(sim, &sub_sim, "Load test with simulated peripherals.", NULL),
+#endif
+#ifdef CONFIG_BRIDGE_TRACE
+    SHELL_CMD(trace, &sub_trace, "Binary trace of the bridge hot paths.", NULL),
+#endif
+    SHELL_CMD(startup_stats, NULL, "Print bridge start milestones (uptime, -1 if not reached).",
+              startup_stats),
+    SHELL_CMD(ble_stats, NULL,
+              "Print BLE connection, reconnect, radio, write and advertisement statistics.",
+              ble_stats),
     SHELL_CMD(remove_bond, NULL, "Remove bondings.", remove_bond),
     SHELL_CMD(reboot, NULL, "System cold reboot.", reboot),
     SHELL_CMD_ARG(set_remote_oob, NULL, " <oob rand> <oob confirm>", cmd_oob_remote, 5, 0),
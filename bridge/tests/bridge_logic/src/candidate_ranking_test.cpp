@@ -0,0 +1,123 @@
+#include <zephyr/ztest.h>
+
+#include "candidate_ranking.h"
+
+using namespace CandidateRanking;
+
+static bt_addr_le_t Addr(uint8_t last) {
+  bt_addr_le_t addr = {BT_ADDR_LE_RANDOM, {{last, 0x00, 0x00, 0x00, 0x00, 0xc0}}};
+  return addr;
+}
+
+static bool Add(Candidate *candidates, uint8_t &count, uint8_t maxCount, uint8_t addr,
+                int8_t rssi, bool bonded = false) {
+  bt_addr_le_t peer = Addr(addr);
+  return AddReport(candidates, count, maxCount, &peer, rssi, bonded);
+}
+
+static bool Is(const Candidate &candidate, uint8_t addr) {
+  bt_addr_le_t peer = Addr(addr);
+  return bt_addr_le_eq(&candidate.addr, &peer);
+}
+
+ZTEST_SUITE(candidate_ranking, NULL, NULL, NULL, NULL, NULL);
+
+ZTEST(candidate_ranking, test_reports_of_one_advertiser_are_averaged) {
+  Candidate candidates[4];
+  uint8_t count = 0;
+
+  zassert_true(Add(candidates, count, 4, 1, -60));
+  zassert_true(Add(candidates, count, 4, 1, -70));
+  zassert_equal(count, 1);
+  zassert_equal(candidates[0].reports, 2);
+  zassert_equal(MeanRssi(candidates[0]), -65);
+}
+
+ZTEST(candidate_ranking, test_bonded_bonus_against_rssi) {
+  Candidate candidates[4];
+  uint8_t count = 0;
+
+  // Within the bonus the bonded peer wins.
+  Add(candidates, count, 4, 1, -60);
+  Add(candidates, count, 4, 2, -60 - kBondedBonusDb + 1, true);
+  Rank(candidates, count);
+  zassert_true(Is(candidates[0], 2));
+
+  // Beyond it the stronger signal does.
+  count = 0;
+  Add(candidates, count, 4, 1, -60);
+  Add(candidates, count, 4, 2, -60 - kBondedBonusDb - 1, true);
+  Rank(candidates, count);
+  zassert_true(Is(candidates[0], 1));
+}
+
+ZTEST(candidate_ranking, test_unknown_rssi_ranks_last) {
+  Candidate candidates[4];
+  uint8_t count = 0;
+
+  Add(candidates, count, 4, 1, kRssiUnknown);
+  Add(candidates, count, 4, 2, -100);
+  zassert_equal(MeanRssi(candidates[0]), kRssiMin);
+  Rank(candidates, count);
+  zassert_true(Is(candidates[0], 2));
+  zassert_true(Is(candidates[1], 1));
+}
+
+ZTEST(candidate_ranking, test_full_list_replaces_worst) {
+  Candidate candidates[3];
+  uint8_t count = 0;
+
+  Add(candidates, count, 3, 1, -50);
+  Add(candidates, count, 3, 2, -80);
+  Add(candidates, count, 3, 3, -60);
+
+  // Not better than the worst one.
+  zassert_false(Add(candidates, count, 3, 4, -80));
+  zassert_equal(count, 3);
+
+  // Takes the place of the worst one, -80.
+  zassert_true(Add(candidates, count, 3, 5, -70));
+  zassert_equal(count, 3);
+  Rank(candidates, count);
+  zassert_true(Is(candidates[0], 1));
+  zassert_true(Is(candidates[1], 3));
+  zassert_true(Is(candidates[2], 5));
+
+  // Candidates in the list keep collecting reports.
+  zassert_true(Add(candidates, count, 3, 5, -30));
+  Rank(candidates, count);
+  zassert_true(Is(candidates[0], 5));
+}
+
+ZTEST(candidate_ranking, test_ties) {
+  Candidate candidates[4];
+  uint8_t count = 0;
+
+  // Same mean, more reports first.
+  Add(candidates, count, 4, 1, -60);
+  Add(candidates, count, 4, 2, -60);
+  Add(candidates, count, 4, 2, -60);
+  // Same mean and reports, the earlier advertiser first.
+  Add(candidates, count, 4, 3, -70);
+  Add(candidates, count, 4, 4, -70);
+  Rank(candidates, count);
+  zassert_true(Is(candidates[0], 2));
+  zassert_true(Is(candidates[1], 1));
+  zassert_true(Is(candidates[2], 3));
+  zassert_true(Is(candidates[3], 4));
+
+  // A tie with a full list goes to the candidates already in it.
+  zassert_false(Add(candidates, count, 4, 5, -70));
+}
+
+ZTEST(candidate_ranking, test_replacement_comes_after_earlier_ties) {
+  Candidate candidates[2];
+  uint8_t count = 0;
+
+  Add(candidates, count, 2, 1, -60);
+  Add(candidates, count, 2, 2, -90);
+  zassert_true(Add(candidates, count, 2, 3, -60));
+  Rank(candidates, count);
+  zassert_true(Is(candidates[0], 1));
+  zassert_true(Is(candidates[1], 3));
+}
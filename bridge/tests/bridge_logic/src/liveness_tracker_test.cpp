@@ -0,0 +1,105 @@
+#include <zephyr/ztest.h>
+
+#include "liveness_tracker.h"
+
+// Expect a value every second, gone after three missed ones, within 2 s to 10 s.
+static const LivenessTracker::Profile kProfile = {1000, 3, 2000, 10000};
+
+ZTEST_SUITE(liveness_tracker, NULL, NULL, NULL, NULL, NULL);
+
+ZTEST(liveness_tracker, test_expires_after_missed_intervals) {
+  LivenessTracker tracker;
+  tracker.Start(kProfile, 0);
+  zassert_equal(tracker.GetTimeoutMs(), 3000);
+
+  zassert_false(tracker.Check(2999));
+  zassert_true(tracker.Check(3000));
+  zassert_true(tracker.IsExpired());
+  zassert_equal(tracker.GetStats().expirations, 1);
+  zassert_equal(tracker.GetStats().lastDetectionMs, 3000);
+
+  // Once per silence.
+  zassert_false(tracker.Check(4000));
+  zassert_equal(tracker.GetStats().expirations, 1);
+}
+
+ZTEST(liveness_tracker, test_value_after_silence_revives) {
+  LivenessTracker tracker;
+  tracker.Start(kProfile, 0);
+  tracker.Seen(1000);
+  zassert_true(tracker.Check(4000));
+
+  zassert_true(tracker.Seen(9000));
+  zassert_false(tracker.IsExpired());
+  // The silence is no interval of the cadence.
+  zassert_equal(tracker.GetIntervalMs(), 1000);
+  zassert_false(tracker.Seen(10000));
+}
+
+ZTEST(liveness_tracker, test_interval_follows_cadence) {
+  LivenessTracker tracker;
+  tracker.Start(kProfile, 0);
+
+  // The first value only starts the measurement.
+  tracker.Seen(5);
+  zassert_equal(tracker.GetIntervalMs(), 1000);
+  tracker.Seen(505);
+  zassert_equal(tracker.GetIntervalMs(), (7 * 1000 + 500) / 8);
+
+  // A faster cadence, the timeout stays at its minimum.
+  int64_t nowMs = 505;
+  for (int i = 0; i < 100; i++) {
+    nowMs += 100;
+    tracker.Seen(nowMs);
+  }
+  zassert_equal(tracker.GetIntervalMs(), 100);
+  zassert_equal(tracker.GetTimeoutMs(), kProfile.minTimeoutMs);
+
+  // A slower one, the timeout stops at its maximum.
+  for (int i = 0; i < 100; i++) {
+    nowMs += 5000;
+    tracker.Seen(nowMs);
+  }
+  // Rounding down, the average stays a few ms short of a rising cadence.
+  zassert_true(tracker.GetIntervalMs() > 4990 && tracker.GetIntervalMs() <= 5000);
+  zassert_equal(tracker.GetTimeoutMs(), kProfile.maxTimeoutMs);
+}
+
+ZTEST(liveness_tracker, test_unknown_interval_uses_max_timeout) {
+  LivenessTracker tracker;
+  tracker.Start({0, 3, 2000, 10000}, 0);
+  zassert_equal(tracker.GetTimeoutMs(), 10000);
+
+  tracker.Seen(0);
+  tracker.Seen(1000);
+  zassert_equal(tracker.GetIntervalMs(), 1000);
+  zassert_equal(tracker.GetTimeoutMs(), 3000);
+}
+
+ZTEST(liveness_tracker, test_detection_latency_is_bounded) {
+  static constexpr uint32_t kCheckPeriodMs = 700;
+
+  for (int64_t lastSeenMs = 0; lastSeenMs < kCheckPeriodMs; lastSeenMs += 50) {
+    LivenessTracker tracker;
+    tracker.Start(kProfile, 0);
+    tracker.Seen(lastSeenMs);
+
+    int64_t nowMs = 0;
+    while (!tracker.Check(nowMs)) {
+      nowMs += kCheckPeriodMs;
+    }
+    uint32_t detectionMs = tracker.GetStats().lastDetectionMs;
+    zassert_equal(detectionMs, nowMs - lastSeenMs);
+    zassert_true(detectionMs >= tracker.GetTimeoutMs());
+    zassert_true(detectionMs < kProfile.maxTimeoutMs + kCheckPeriodMs);
+  }
+}
+
+ZTEST(liveness_tracker, test_stopped_does_not_expire) {
+  LivenessTracker tracker;
+  tracker.Start(kProfile, 0);
+  tracker.Stop();
+  zassert_false(tracker.Check(100000));
+  zassert_false(tracker.Seen(100000));
+  zassert_false(tracker.IsActive());
+}
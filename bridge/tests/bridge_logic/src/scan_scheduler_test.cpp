@@ -0,0 +1,75 @@
+#include <zephyr/ztest.h>
+
+#include "scan_scheduler.h"
+
+ZTEST_SUITE(scan_scheduler, NULL, NULL, NULL, NULL, NULL);
+
+ZTEST(scan_scheduler, test_interval_doubles_up_to_cap) {
+  uint16_t interval = ScanScheduler::kMinInterval;
+  for (uint8_t connections = 0; connections < 10; connections++) {
+    ScanScheduler::Parameters parameters = ScanScheduler::Select({connections, false, false});
+    zassert_equal(parameters.interval, MIN(interval, ScanScheduler::kMaxInterval),
+                  "%u connections", connections);
+    zassert_equal(parameters.window, ScanScheduler::kWindow);
+    interval = MIN((uint32_t)interval * 2, UINT16_MAX);
+  }
+  zassert_equal(ScanScheduler::Select({255, true, false}).interval, ScanScheduler::kMaxInterval);
+}
+
+ZTEST(scan_scheduler, test_advertising_counts_as_connection) {
+  ScanScheduler::Parameters advertising = ScanScheduler::Select({1, true, false});
+  zassert_equal(advertising.interval, ScanScheduler::Select({2, false, false}).interval);
+}
+
+ZTEST(scan_scheduler, test_active_only_without_advertising) {
+  zassert_true(ScanScheduler::Select({0, false, true}).active);
+  zassert_true(ScanScheduler::Select({3, false, true}).active);
+  zassert_false(ScanScheduler::Select({0, false, false}).active);
+  // Scan requests would hold up advertising events.
+  zassert_false(ScanScheduler::Select({0, true, true}).active);
+}
+
+ZTEST(scan_scheduler, test_accounting) {
+  ScanScheduler scheduler;
+  ScanScheduler::Parameters fast = {true, ScanScheduler::kMinInterval, ScanScheduler::kWindow};
+  ScanScheduler::Parameters slow = {false, 4 * ScanScheduler::kMinInterval,
+                                    ScanScheduler::kWindow};
+  zassert_false(scheduler.IsRunning());
+
+  // 1000 ms active at a window of half the interval.
+  scheduler.Start(fast, 0);
+  zassert_true(scheduler.IsRunning());
+  ScanScheduler::Stats stats = scheduler.GetStats(1000);
+  zassert_equal(stats.scanMs, 1000);
+  zassert_equal(stats.activeScanMs, 1000);
+  zassert_equal(stats.radioOnMs, 500);
+
+  // 2000 ms passive at an eighth.
+  scheduler.Start(slow, 1000);
+  zassert_equal(scheduler.GetParameters(), slow);
+  scheduler.Stop(3000);
+  zassert_false(scheduler.IsRunning());
+  stats = scheduler.GetStats(10000);
+  zassert_equal(stats.scanMs, 3000);
+  zassert_equal(stats.activeScanMs, 1000);
+  zassert_equal(stats.radioOnMs, 500 + 250);
+  zassert_equal(stats.parameterChanges, 1);
+}
+
+ZTEST(scan_scheduler, test_parameter_changes) {
+  ScanScheduler scheduler;
+  ScanScheduler::Parameters fast = ScanScheduler::Select({0, false, false});
+  ScanScheduler::Parameters slow = ScanScheduler::Select({2, false, false});
+
+  // The first start and restarts with the same parameters are no change.
+  scheduler.Start(fast, 0);
+  scheduler.Stop(100);
+  scheduler.Start(fast, 200);
+  zassert_equal(scheduler.GetStats(300).parameterChanges, 0);
+
+  scheduler.Start(slow, 300);
+  scheduler.Start(fast, 400);
+  zassert_equal(scheduler.GetStats(500).parameterChanges, 2);
+  // Stopped time does not count.
+  zassert_equal(scheduler.GetStats(500).scanMs, 400);
+}
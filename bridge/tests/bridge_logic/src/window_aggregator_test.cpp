@@ -0,0 +1,124 @@
+#include <zephyr/ztest.h>
+
+#include "window_aggregator.h"
+
+// Summary of the last window samples of values[0..added), computed the plain way.
+static WindowAggregator::Summary Reference(const uint16_t *values, uint32_t added, uint8_t window) {
+  uint8_t count = MIN(added, window);
+  WindowAggregator::Summary summary = {UINT16_MAX, 0, 0, count};
+  uint32_t sum = 0;
+  for (uint32_t i = added - count; i < added; i++) {
+    summary.min = MIN(summary.min, values[i]);
+    summary.max = MAX(summary.max, values[i]);
+    sum += values[i];
+  }
+  summary.mean = (sum + count / 2) / count;
+  return summary;
+}
+
+// Compare against the reference after every sample, well past the wrap of the uint8_t positions.
+static void CheckAgainstReference(uint8_t window, uint16_t range) {
+  static constexpr uint32_t kSamples = 3 * 256 + 17;
+  static uint16_t values[kSamples];
+  uint32_t seed = 12345;
+
+  WindowAggregator aggregator;
+  aggregator.Configure(window, 1);
+  for (uint32_t i = 0; i < kSamples; i++) {
+    seed = seed * 1103515245 + 12345;
+    values[i] = (seed >> 16) % range;
+    aggregator.Add(values[i]);
+
+    WindowAggregator::Summary expected = Reference(values, i + 1, window);
+    WindowAggregator::Summary summary = aggregator.GetSummary();
+    zassert_equal(summary.count, expected.count, "window %u, sample %u", window, i);
+    zassert_equal(summary.min, expected.min, "window %u, sample %u", window, i);
+    zassert_equal(summary.mean, expected.mean, "window %u, sample %u", window, i);
+    zassert_equal(summary.max, expected.max, "window %u, sample %u", window, i);
+  }
+}
+
+ZTEST_SUITE(window_aggregator, NULL, NULL, NULL, NULL, NULL);
+
+ZTEST(window_aggregator, test_empty) {
+  WindowAggregator aggregator;
+  aggregator.Configure(8, 1);
+  zassert_equal(aggregator.GetSummary().count, 0);
+}
+
+ZTEST(window_aggregator, test_window_1) {
+  WindowAggregator aggregator;
+  aggregator.Configure(1, 1);
+  aggregator.Add(5);
+  aggregator.Add(3);
+  WindowAggregator::Summary summary = aggregator.GetSummary();
+  zassert_equal(summary.count, 1);
+  zassert_equal(summary.min, 3);
+  zassert_equal(summary.mean, 3);
+  zassert_equal(summary.max, 3);
+
+  CheckAgainstReference(1, 1000);
+}
+
+ZTEST(window_aggregator, test_eviction_of_extremes) {
+  WindowAggregator aggregator;
+  aggregator.Configure(3, 1);
+  // The maximum 9 leaves the window after three more samples, the minimum 1 after the next.
+  aggregator.Add(9);
+  aggregator.Add(1);
+  aggregator.Add(5);
+  zassert_equal(aggregator.GetSummary().max, 9);
+  aggregator.Add(4);
+  zassert_equal(aggregator.GetSummary().max, 5);
+  zassert_equal(aggregator.GetSummary().min, 1);
+  aggregator.Add(6);
+  zassert_equal(aggregator.GetSummary().min, 4);
+  zassert_equal(aggregator.GetSummary().max, 6);
+}
+
+ZTEST(window_aggregator, test_position_wrap) {
+  CheckAgainstReference(7, 1000);
+  // Few distinct values, equal samples in the queues.
+  CheckAgainstReference(16, 3);
+}
+
+ZTEST(window_aggregator, test_window_64) {
+  CheckAgainstReference(WindowAggregator::kMaxWindow, 1000);
+  CheckAgainstReference(WindowAggregator::kMaxWindow, 2);
+}
+
+ZTEST(window_aggregator, test_configure_clamps) {
+  WindowAggregator aggregator;
+  aggregator.Configure(0, 0);
+  // Window and hop of 1: every sample closes the window and is its summary.
+  zassert_true(aggregator.Add(7));
+  zassert_true(aggregator.Add(2));
+  zassert_equal(aggregator.GetSummary().count, 1);
+  zassert_equal(aggregator.GetSummary().max, 2);
+
+  aggregator.Configure(200, 1);
+  for (uint16_t i = 0; i < 100; i++) {
+    aggregator.Add(i);
+  }
+  zassert_equal(aggregator.GetSummary().count, WindowAggregator::kMaxWindow);
+  zassert_equal(aggregator.GetSummary().min, 100 - WindowAggregator::kMaxWindow);
+}
+
+ZTEST(window_aggregator, test_hop_closes_window) {
+  WindowAggregator aggregator;
+  aggregator.Configure(4, 3);
+  for (uint16_t i = 1; i <= 9; i++) {
+    zassert_equal(aggregator.Add(i), i % 3 == 0, "sample %u", i);
+  }
+  WindowAggregator::Summary summary = aggregator.GetSummary();
+  zassert_equal(summary.min, 6);
+  zassert_equal(summary.mean, 8);
+  zassert_equal(summary.max, 9);
+
+  // Reset starts the hop over.
+  aggregator.Reset();
+  zassert_false(aggregator.Add(1));
+  zassert_false(aggregator.Add(1));
+  zassert_true(aggregator.Add(1));
+  zassert_equal(aggregator.GetSummary().count, 3);
+}